@@ -9,6 +9,8 @@
 #include "/Users/andreypavlinich/ProjectPlayer-1/VideoPlayerFront/include/VolumeBar.hpp"
 
 #include "../VideoPlayerBack/API/MediaPlayer.hpp"
+#include "../VideoPlayerBack/include/ThumbnailCache.hpp"
+#include "../VideoPlayerBack/include/ThumbnailGenerator.hpp"
 
 // UI Constants
 const sf::Color BACKGROUND_COLOR(30, 30, 30);
@@ -479,6 +481,14 @@ int main(int argc, char* argv[]) {
     // Create media player
     MediaPlayer player;
 
+    // Progress bar previews, generated in the background for every opened file and cached on disk
+    ThumbnailCache thumbnailCache;
+    ThumbnailGenerator thumbnails;
+    thumbnails.setCache(&thumbnailCache);
+    sf::Texture previewTexture;
+    size_t previewIndex = 0;
+    bool hasPreview = false;
+
     // Create UI components
     Button playButton("Play", font);
     Button pauseButton("Pause", font);
@@ -529,31 +539,39 @@ int main(int argc, char* argv[]) {
     sf::Sprite videoSprite;
     videoSprite.setPosition(10, 50);
 
+    // Convert frames at the size they are shown at instead of shrinking a full resolution texture
+    player.setOutputSize(sf::Vector2u(videoBackground.getSize().x, videoBackground.getSize().y));
+
     // Set up callbacks
-    fileBrowser.setFileSelectedCallback([&](const std::string& filename) {
-        if (player.open(filename)) {
-            std::cout << "Opened: " << filename << std::endl;
-            player.play();
-        } else {
-            std::cerr << "Failed to open: " << filename << std::endl;
-        }
-    });
+    // Files are opened in the background, playback starts once the first frame is ready
+    auto openFile = [&](const std::string& filename) {
+        player.openAsync(filename, [&, filename](bool success) {
+            if (success) {
+                std::cout << "Opened: " << filename << std::endl;
+                player.play();
+
+                thumbnails.start(filename, 100, sf::Vector2u(160, 90));
+                progressBar.clearPreview();
+                hasPreview = false;
+            } else {
+                std::cerr << "Failed to open: " << filename << std::endl;
+            }
+        });
+    };
+
+    fileBrowser.setFileSelectedCallback(openFile);
 
     // Try to open file from command line argument
     if (argc > 1) {
-        std::string filename = argv[1];
-        if (player.open(filename)) {
-            std::cout << "Opened: " << filename << std::endl;
-            player.play();
-        } else {
-            std::cerr << "Failed to open: " << filename << std::endl;
-        }
+        openFile(argv[1]);
     }
 
     // Main loop
     sf::Clock clock;
     bool isDraggingProgressBar = false;
     bool isDraggingVolumeBar = false;
+    bool isHoveringProgressBar = false;
+    float progressBarHoverX = 0.0f;
     bool wasVideoEnded = false;
 
     while (window.isOpen()) {
@@ -563,6 +581,20 @@ int main(int argc, char* argv[]) {
                 window.close();
             }
 
+            // Keep the layout in window pixels and follow the new video area size
+            if (event.type == sf::Event::Resized) {
+                sf::Vector2f windowSize(event.size.width, event.size.height);
+                window.setView(sf::View(sf::FloatRect(0, 0, windowSize.x, windowSize.y)));
+
+                videoBackground.setSize(sf::Vector2f(std::max(1.0f, windowSize.x - 20), std::max(1.0f, windowSize.y - 140)));
+                progressBar.setSize(windowSize.x - 20, 10);
+                progressBar.setPosition(10, windowSize.y - 60);
+                volumeBar.setPosition(windowSize.x - 170, windowSize.y - 100);
+                fileBrowser.setPosition((windowSize.x - 500) / 2, (windowSize.y - 400) / 2);
+
+                player.setOutputSize(sf::Vector2u(videoBackground.getSize().x, videoBackground.getSize().y));
+            }
+
             // Handle file browser events
             if (fileBrowser.isVisible()) {
                 fileBrowser.handleEvent(event, window);
@@ -579,24 +611,15 @@ int main(int argc, char* argv[]) {
                 nextButton.setHoverState(nextButton.contains(mousePos));
                 openButton.setHoverState(openButton.contains(mousePos));
 
-                // Update progress bar if dragging
+                isHoveringProgressBar = progressBar.contains(mousePos) || isDraggingProgressBar;
+                progressBarHoverX = mousePos.x;
+                progressBar.setHoverState(isHoveringProgressBar, progressBarHoverX);
+
+                // Update progress bar if dragging, the player only decodes the latest position
                 if (isDraggingProgressBar) {
                     double seekPos = progressBar.getPositionFromClick(mousePos.x);
                     if (seekPos >= 0 && seekPos <= player.getDuration()) {
-                        // Важно: делаем принудительный flush аудио при перемотке
-                        bool wasPlaying = player.isPlaying();
-                        player.pause(); // Временно останавливаем
-                        player.seek(seekPos);
-
-                        // Даем небольшую задержку для синхронизации
-                        sf::sleep(sf::milliseconds(10));
-
-                        // Восстанавливаем состояние воспроизведения
-                        if (wasPlaying) {
-                            player.play();
-                        }
-
-                        std::cout << "Dragging to: " << seekPos << " seconds" << std::endl;
+                        player.scrubTo(seekPos);
                     }
                 }
 
@@ -619,29 +642,13 @@ int main(int argc, char* argv[]) {
                     pauseButton.setActiveState(true);
                 } else if (prevButton.contains(mousePos)) {
                     double newPos = std::max(0.0, player.getCurrentPosition() - 10.0);
-
-                    // Улучшенная синхронизация для кнопки "назад"
-                    bool wasPlaying = player.isPlaying();
-                    player.pause();
-                    player.seek(newPos);
-                    sf::sleep(sf::milliseconds(50)); // Даем время на синхронизацию
-                    if (wasPlaying) {
-                        player.play();
-                    }
+                    player.seekAsync(newPos);
 
                     prevButton.setActiveState(true);
                     std::cout << "Seeking backward to: " << newPos << " seconds" << std::endl;
                 } else if (nextButton.contains(mousePos)) {
                     double newPos = std::min(player.getDuration(), player.getCurrentPosition() + 10.0);
-
-                    // Улучшенная синхронизация для кнопки "вперед"
-                    bool wasPlaying = player.isPlaying();
-                    player.pause();
-                    player.seek(newPos);
-                    sf::sleep(sf::milliseconds(50)); // Даем время на синхронизацию
-                    if (wasPlaying) {
-                        player.play();
-                    }
+                    player.seekAsync(newPos);
 
                     nextButton.setActiveState(true);
                     std::cout << "Seeking forward to: " << newPos << " seconds" << std::endl;
@@ -650,19 +657,11 @@ int main(int argc, char* argv[]) {
                     openButton.setActiveState(true);
                 } else if (progressBar.contains(mousePos)) {
                     isDraggingProgressBar = true;
+                    player.beginScrub();
+
                     double seekPos = progressBar.getPositionFromClick(mousePos.x);
                     if (seekPos >= 0 && seekPos <= player.getDuration()) {
-                        // Улучшенная синхронизация при клике на прогресс-бар
-                        bool wasPlaying = player.isPlaying();
-                        player.pause();
-                        player.seek(seekPos);
-                        sf::sleep(sf::milliseconds(30)); // Задержка для синхронизации
-
-                        if (wasPlaying) {
-                            player.play();
-                        }
-
-                        std::cout << "Seeking to: " << seekPos << " seconds" << std::endl;
+                        player.scrubTo(seekPos);
                     }
                 } else if (volumeBar.contains(mousePos)) {
                     isDraggingVolumeBar = true;
@@ -680,11 +679,10 @@ int main(int argc, char* argv[]) {
                 nextButton.setActiveState(false);
                 openButton.setActiveState(false);
 
-                // При отпускании мыши с прогресс-бара делаем финальную синхронизацию
+                // Land exactly on the final position once the drag ends
                 if (isDraggingProgressBar) {
-                    // Финальная синхронизация при завершении перетаскивания
-                    player.update(); // Принудительное обновление
-                    sf::sleep(sf::milliseconds(20));
+                    player.endScrub();
+                    std::cout << "Seeking to: " << player.getCurrentPosition() << " seconds" << std::endl;
                 }
 
                 isDraggingProgressBar = false;
@@ -700,15 +698,7 @@ int main(int argc, char* argv[]) {
                     case sf::Keyboard::Left:
                         {
                             double newPos = std::max(0.0, player.getCurrentPosition() - 5.0);
-
-                            // Улучшенная синхронизация для клавиш
-                            bool wasPlaying = player.isPlaying();
-                            player.pause();
-                            player.seek(newPos);
-                            sf::sleep(sf::milliseconds(50));
-                            if (wasPlaying) {
-                                player.play();
-                            }
+                            player.seekAsync(newPos);
 
                             std::cout << "Seeking backward (keyboard) to: " << newPos << " seconds" << std::endl;
                         }
@@ -716,15 +706,7 @@ int main(int argc, char* argv[]) {
                     case sf::Keyboard::Right:
                         {
                             double newPos = std::min(player.getDuration(), player.getCurrentPosition() + 5.0);
-
-                            // Улучшенная синхронизация для клавиш
-                            bool wasPlaying = player.isPlaying();
-                            player.pause();
-                            player.seek(newPos);
-                            sf::sleep(sf::milliseconds(50));
-                            if (wasPlaying) {
-                                player.play();
-                            }
+                            player.seekAsync(newPos);
 
                             std::cout << "Seeking forward (keyboard) to: " << newPos << " seconds" << std::endl;
                         }
@@ -761,9 +743,11 @@ int main(int argc, char* argv[]) {
         bool isVideoEnded = progressBar.isVideoEnded();
         if (isVideoEnded && !wasVideoEnded && player.getDuration() > 0) {
             // Video just ended, restart from beginning
-            player.seek(0.0);
-            sf::sleep(sf::milliseconds(100)); // Даем время на синхронизацию
-            player.play();
+            player.seekAsync(0.0, [&player](bool success) {
+                if (success) {
+                    player.play();
+                }
+            });
             std::cout << "Video ended, restarting from beginning" << std::endl;
         }
         wasVideoEnded = isVideoEnded;
@@ -793,6 +777,22 @@ int main(int argc, char* argv[]) {
         // Update progress bar with playing state
         progressBar.update(player.getCurrentPosition(), player.getDuration(), player.isPlaying());
 
+        // Show the thumbnail under the mouse, it appears as soon as the generator reaches it
+        if (isHoveringProgressBar) {
+            size_t index = thumbnails.getIndex(progressBar.getPositionFromClick(progressBarHoverX));
+            ThumbnailGenerator::Thumbnail thumbnail;
+
+            if ((!hasPreview || index != previewIndex) && thumbnails.getThumbnail(index, thumbnail)) {
+                if (previewTexture.getSize() != thumbnail.size) {
+                    previewTexture.create(thumbnail.size.x, thumbnail.size.y);
+                }
+                previewTexture.update(thumbnail.pixels.data());
+                progressBar.setPreview(previewTexture);
+                previewIndex = index;
+                hasPreview = true;
+            }
+        }
+
         // Clear window
         window.clear(BACKGROUND_COLOR);
 
@@ -819,6 +819,7 @@ int main(int argc, char* argv[]) {
     }
 
     // Clean up
+    thumbnails.stop();
     player.close();
 
     return 0;
@@ -1,14 +1,31 @@
 #include "MediaPlayer.hpp"
 
+#include <algorithm>
 #include <iostream>
 
+#include "../include/PrefetchInput.hpp"
+
 // CustomAudioStream implementation
-MediaPlayer::CustomAudioStream::CustomAudioStream(AudioDecoder& decoder) : audioDecoder(decoder) {
-    // Initialize audio stream
-    initialize(decoder.getChannelCount(), decoder.getSampleRate());
+MediaPlayer::CustomAudioStream::CustomAudioStream(AudioDecoder* decoder, uint64_t serial)
+    : audioDecoder(decoder),
+      decoderSerial(serial),
+      nextDecoder(nullptr),
+      nextSerial(0),
+      samplesQueued(0),
+      firstChunkDelivered(false),
+      underruns(0) {
+    // Initialize audio stream, every decoder resamples to the same format so decoders can be switched
+    initialize(decoder->getChannelCount(), decoder->getSampleRate());
 }
 
 void MediaPlayer::CustomAudioStream::start() {
+    // Playing offset restarts from zero after stop(), so does the chunk bookkeeping
+    {
+        std::lock_guard<std::mutex> lock(timingMutex);
+        chunkTimings.clear();
+        samplesQueued = 0;
+    }
+
     play();
 }
 
@@ -16,13 +33,86 @@ void MediaPlayer::CustomAudioStream::stop() {
     sf::SoundStream::stop();
 }
 
+bool MediaPlayer::CustomAudioStream::setDecoder(AudioDecoder* decoder, uint64_t serial) {
+    std::lock_guard<std::mutex> lock(decoderMutex);
+
+    bool switched = audioDecoder != decoder;
+    audioDecoder = decoder;
+    decoderSerial = serial;
+    nextDecoder = nullptr;
+
+    return switched;
+}
+
+void MediaPlayer::CustomAudioStream::queueDecoder(AudioDecoder* decoder, uint64_t serial) {
+    std::lock_guard<std::mutex> lock(decoderMutex);
+    nextDecoder = decoder;
+    nextSerial = serial;
+}
+
+bool MediaPlayer::CustomAudioStream::getNextPacket(AudioPacket& packet) {
+    bool waited = false;
+
+    while (true) {
+        if (audioDecoder->getNextPacket(packet)) {
+            return true;
+        }
+
+        // The current decoder has played to the end of its file, continue with the queued one without a gap.
+        // A packet queued right before the end was flagged is taken first.
+        if (nextDecoder && audioDecoder->isEndOfStream()) {
+            if (audioDecoder->getNextPacket(packet)) {
+                return true;
+            }
+
+            audioDecoder = nextDecoder;
+            decoderSerial = nextSerial;
+            nextDecoder = nullptr;
+            continue;
+        }
+
+        // Returning false ends the stream, so give a decoder that just started time to catch up
+        if (waited) {
+            return false;
+        }
+
+        // Playback has caught up with decoding, unless it just started or the file has ended
+        if (!audioDecoder->isEndOfStream()) {
+            std::lock_guard<std::mutex> lock(timingMutex);
+            if (firstChunkDelivered) {
+                underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        audioDecoder->waitForPacket(std::chrono::milliseconds(DATA_WAIT_MS));
+        waited = true;
+    }
+}
+
 bool MediaPlayer::CustomAudioStream::onGetData(Chunk& data) {
-    // Get next audio packet
+    // Decoders are only switched or released while no chunk is being fetched
+    std::lock_guard<std::mutex> decoderLock(decoderMutex);
+
     AudioPacket packet;
-    if (!audioDecoder.getNextPacket(packet)) {
+    if (!getNextPacket(packet)) {
         return false;
     }
 
+    // SFML has copied the previous chunk by now, hand its buffer back for reuse
+    audioDecoder->recycleSamples(std::move(buffer));
+
+    // Remember where this chunk starts so the playing offset can be mapped back to a pts
+    {
+        std::lock_guard<std::mutex> lock(timingMutex);
+        chunkTimings.push_back({samplesQueued, packet.pts, decoderSerial});
+        samplesQueued += packet.samples.size();
+
+        if (!firstChunkDelivered) {
+            firstChunkTime = std::chrono::steady_clock::now();
+            firstChunkDelivered = true;
+        }
+    }
+
     // Set buffer data
     buffer = std::move(packet.samples);
     data.samples = buffer.data();
@@ -35,14 +125,77 @@ void MediaPlayer::CustomAudioStream::onSeek(sf::Time timeOffset) {
     // Not implemented, seeking is handled by MediaPlayer
 }
 
+bool MediaPlayer::CustomAudioStream::getClock(double& seconds, uint64_t& serial) {
+    std::lock_guard<std::mutex> lock(timingMutex);
+
+    sf::Uint64 samplesPerSecond = static_cast<sf::Uint64>(getSampleRate()) * getChannelCount();
+    if (chunkTimings.empty() || samplesPerSecond == 0 || getStatus() != sf::SoundSource::Playing) {
+        return false;
+    }
+
+    sf::Uint64 played = static_cast<sf::Uint64>(getPlayingOffset().asMicroseconds()) * samplesPerSecond / 1000000;
+
+    // Forget chunks that have finished playing
+    while (chunkTimings.size() > 1 && chunkTimings[1].firstSample <= played) {
+        chunkTimings.pop_front();
+    }
+
+    const ChunkTiming& chunk = chunkTimings.front();
+    if (played < chunk.firstSample) {
+        return false;
+    }
+
+    seconds = chunk.pts + static_cast<double>(played - chunk.firstSample) / samplesPerSecond;
+    serial = chunk.serial;
+    return true;
+}
+
+uint64_t MediaPlayer::CustomAudioStream::getUnderrunCount() const {
+    return underruns.load(std::memory_order_relaxed);
+}
+
+bool MediaPlayer::CustomAudioStream::getFirstChunkTime(std::chrono::steady_clock::time_point& time) {
+    std::lock_guard<std::mutex> lock(timingMutex);
+
+    if (!firstChunkDelivered) {
+        return false;
+    }
+
+    time = firstChunkTime;
+    return true;
+}
+
 // MediaPlayer implementation
-MediaPlayer::MediaPlayer() : playing(false), volume(1.0f), currentPosition(0.0), newFrameAvailable(false) {
-    // Set error callback
-    ErrorHandler::getInstance().setErrorCallback([this](const MediaPlayerException& e) {
-        if (e.getCode() == MediaPlayerException::FILE_NOT_FOUND || e.getCode() == MediaPlayerException::DECODER_ERROR) {
-            close();
-        }
-    });
+MediaPlayer::MediaPlayer()
+    : videoDecoder(std::make_unique<VideoDecoder>()),
+      audioDecoder(std::make_unique<AudioDecoder>()),
+      playing(false),
+      volume(1.0f),
+      currentPosition(0.0),
+      newFrameAvailable(false),
+      firstFramePending(true),
+      openInProgress(false),
+      inputMode(Demuxer::FILE_PROTOCOL),
+      prefetchWindow(PrefetchInput::DEFAULT_WINDOW_SIZE),
+      startupStats{-1.0, -1.0, -1.0, -1.0, -1.0},
+      audioStartDeferred(false),
+      playlistIndex(-1),
+      preloadFailed(false),
+      itemSerial(0),
+      lastFramePts(-1.0),
+      seekMode(EXACT),
+      scrubbing(false),
+      playingBeforeScrub(false),
+      scrubPosition(0.0),
+      lastSeekLatency(0.0),
+      seekCount(0),
+      completedSeeks(0),
+      totalSeekLatency(0.0),
+      maxSeekLatency(0.0),
+      syncDrift(0.0),
+      presentedFrames(0),
+      droppedFrames(0),
+      audioClockActive(false) {
 }
 
 MediaPlayer::~MediaPlayer() {
@@ -50,62 +203,169 @@ MediaPlayer::~MediaPlayer() {
 }
 
 bool MediaPlayer::open(const std::string& filename) {
+    // A single file replaces the playlist
+    clearPlaylist();
+    return openFile(filename, true);
+}
+
+bool MediaPlayer::openFile(const std::string& filename, bool looping) {
     // Close any previously opened file
     close();
 
-    // Open the media file
-    if (!videoDecoder.open(filename)) {
+    beginStartup();
+
+    // Open the media file once, both decoders consume packets from the same demuxer
+    auto openedDemuxer = std::make_shared<Demuxer>();
+    openedDemuxer->setLooping(looping);
+    openedDemuxer->setInputMode(inputMode);
+    openedDemuxer->setPrefetchWindow(prefetchWindow);
+    if (!openedDemuxer->open(filename)) {
+        openedDemuxer->getErrorChannel().forwardTo(errors);
+        dispatchErrors();
         return false;
     }
 
-    // Initialize video decoder
-    if (!videoDecoder.initialize()) {
-        videoDecoder.close();
+    recordStartupStage(&StartupStats::probe);
+    return openDemuxer(std::move(openedDemuxer));
+}
+
+bool MediaPlayer::openDemuxer(std::shared_ptr<Demuxer> openedDemuxer) {
+    demuxer = std::move(openedDemuxer);
+
+    // Open the audio codec on a worker while the video codec opens here. Errors must not close the
+    // player while opening, failures are handled below instead.
+    bool asyncOpen = openInProgress;
+    openInProgress = true;
+
+    std::future<bool> audioOpened = std::async(std::launch::async, [this] { return audioDecoder->open(demuxer) && audioDecoder->initialize(); });
+    bool hasVideo = videoDecoder->open(demuxer) && videoDecoder->initialize();
+    bool hasAudio = audioOpened.get();
+
+    dispatchErrors();
+    openInProgress = asyncOpen;
+
+    if (!hasVideo) {
+        videoDecoder->close();
+        audioDecoder->close();
+        demuxer.reset();
         return false;
     }
 
-    // Initialize audio decoder if available
-    bool hasAudio = audioDecoder.open(filename) && audioDecoder.initialize();
+    // Audio is optional
+    if (!hasAudio) {
+        audioDecoder->close();
+    }
+
+    recordStartupStage(&StartupStats::codecOpen);
 
-    // Start video decoding
-    videoDecoder.start();
+    // Start video decoding, audio decoding waits until the first frame is ready so it does not compete with it
+    videoDecoder->start();
+
+    ++itemSerial;
 
-    // Start audio decoding if available
     if (hasAudio) {
-        audioDecoder.start();
+        audioStartDeferred = true;
 
         // Create audio stream
-        audioStream = std::make_unique<CustomAudioStream>(audioDecoder);
+        audioStream = std::make_unique<CustomAudioStream>(audioDecoder.get(), itemSerial);
     }
 
     // Reset position and state
     currentPosition = 0.0;
     playing = false;
     newFrameAvailable = false;
+    firstFramePending = true;
+    lastFramePts = -1.0;
+    syncDrift = 0.0;
+    presentedFrames = 0;
+    droppedFrames = 0;
+    audioClockActive = false;
+    presentLatency.reset();
+    updateLatency.reset();
+    seekCount = 0;
+    completedSeeks = 0;
+    totalSeekLatency = 0.0;
+    maxSeekLatency = 0.0;
 
     return true;
 }
 
+std::future<bool> MediaPlayer::openAsync(const std::string& filename, std::function<void(bool)> callback) {
+    // Close any previously opened file, this also fails a pending open or seek. A single file replaces the playlist.
+    clearPlaylist();
+    close();
+
+    auto completion = std::make_unique<Completion>();
+    completion->callback = std::move(callback);
+    std::future<bool> future = completion->promise.get_future();
+
+    // File I/O and stream probing happen off the calling thread, update() attaches the decoders when done.
+    // close() waits for the worker, so it never outlives the player.
+    beginStartup();
+    openInProgress = true;
+    Demuxer::InputMode mode = inputMode;
+    size_t window = prefetchWindow;
+    pendingOpen = std::async(std::launch::async, [this, filename, mode, window]() -> std::shared_ptr<Demuxer> {
+        auto openedDemuxer = std::make_shared<Demuxer>();
+        openedDemuxer->setInputMode(mode);
+        openedDemuxer->setPrefetchWindow(window);
+        if (!openedDemuxer->open(filename)) {
+            openedDemuxer->getErrorChannel().forwardTo(errors);
+            return nullptr;
+        }
+
+        recordStartupStage(&StartupStats::probe);
+        return openedDemuxer;
+    });
+
+    replaceCompletion(std::move(completion));
+    return future;
+}
+
 void MediaPlayer::close() {
+    // Abandon an asynchronous open, its demuxer is closed when the future is dropped
+    if (pendingOpen.valid()) {
+        pendingOpen.wait();
+        pendingOpen = std::future<std::shared_ptr<Demuxer>>();
+        openInProgress = false;
+    }
+
+    replaceCompletion(nullptr);
+
     // Stop playback
     if (playing) {
         pause();
     }
 
+    // Leave scrubbing without seeking
+    scrubbing = false;
+    videoDecoder->setKeyframesOnly(false);
+    audioStartDeferred = false;
+
     // Stop and close decoders
-    videoDecoder.stop();
-    videoDecoder.close();
+    videoDecoder->stop();
+    videoDecoder->close();
+
+    audioDecoder->stop();
+    audioDecoder->close();
 
-    audioDecoder.stop();
-    audioDecoder.close();
+    // Stop reading packets and close the media file
+    demuxer.reset();
 
-    // Reset audio stream
+    // Reset audio stream, then release a preloaded playlist item it may have been about to switch to
     audioStream.reset();
+    dropPreload();
+    playlistIndex = -1;
 
     // Reset state
     currentPosition = 0.0;
     playing = false;
-    newFrameAvailable = false;
+
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        currentFrame.frame.reset();
+        newFrameAvailable = false;
+    }
 
     // Call stop callback
     if (playbackStopCallback) {
@@ -118,14 +378,15 @@ void MediaPlayer::play() {
         return;
     }
 
-    if (!videoDecoder.isOpen()) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Cannot play: no file is open");
+    if (!videoDecoder->isOpen()) {
+        deliverError(MediaPlayerException(MediaPlayerException::DECODER_ERROR, "Cannot play: no file is open"));
         return;
     }
 
     // Start decoders
-    videoDecoder.setPaused(false);
-    audioDecoder.setPaused(false);
+    startDeferredAudio();
+    videoDecoder->setPaused(false);
+    audioDecoder->setPaused(false);
 
     // Start audio playback if available
     if (audioStream) {
@@ -148,8 +409,8 @@ void MediaPlayer::pause() {
     }
 
     // Pause decoders
-    videoDecoder.setPaused(true);
-    audioDecoder.setPaused(true);
+    videoDecoder->setPaused(true);
+    audioDecoder->setPaused(true);
 
     // Pause audio playback if available
     if (audioStream) {
@@ -177,8 +438,8 @@ void MediaPlayer::togglePlayPause() {
 }
 
 void MediaPlayer::seek(double seconds) {
-    if (!videoDecoder.isOpen()) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Cannot seek: no file is open");
+    if (!videoDecoder->isOpen()) {
+        deliverError(MediaPlayerException(MediaPlayerException::DECODER_ERROR, "Cannot seek: no file is open"));
         return;
     }
 
@@ -190,19 +451,34 @@ void MediaPlayer::seek(double seconds) {
         seconds = duration;
     }
 
+    // A blocking seek supersedes pending asynchronous ones
+    replaceCompletion(nullptr);
+
     // Pause playback temporarily
     bool wasPlaying = playing;
     if (playing) {
         pause();
     }
 
-    // Seek in decoders
-    videoDecoder.seek(seconds);
-    audioDecoder.seek(seconds);
+    restoreItemAudio();
 
-    // Update position
+    // Update position, show the first frame decoded at the new position right away
     currentPosition = seconds;
     positionClock.restart();
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        firstFramePending = true;
+        seekStartTime = std::chrono::steady_clock::now();
+        lastSeekLatency = -1.0;
+    }
+    seekCount.fetch_add(1, std::memory_order_relaxed);
+
+    // Seek the shared demuxer once for both streams, an exact seek makes both decoders skip output before the position.
+    // Everything queued for the old position is discarded by its seek epoch.
+    demuxer->seek(seconds, seekMode == EXACT);
+
+    // The frame at the new position is decoded even while paused, update() pauses again once it is out
+    videoDecoder->setPaused(false);
 
     // Notify position change
     notifyPositionChange();
@@ -213,6 +489,108 @@ void MediaPlayer::seek(double seconds) {
     }
 }
 
+std::future<bool> MediaPlayer::seekAsync(double seconds, std::function<void(bool)> callback) {
+    auto completion = std::make_unique<Completion>();
+    completion->callback = std::move(callback);
+    std::future<bool> future = completion->promise.get_future();
+
+    if (!videoDecoder->isOpen() || !demuxer || scrubbing) {
+        finishCompletion(std::move(completion), false);
+        return future;
+    }
+
+    // Clamp position to valid range
+    seconds = std::max(0.0, std::min(seconds, getDuration()));
+
+    currentPosition = seconds;
+    positionClock.restart();
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        firstFramePending = true;
+        seekStartTime = std::chrono::steady_clock::now();
+        lastSeekLatency = -1.0;
+    }
+    seekCount.fetch_add(1, std::memory_order_relaxed);
+    replaceCompletion(std::move(completion));
+
+    // The demuxing thread performs the seek, the frame at the new position is decoded even while paused
+    demuxer->requestSeek(seconds, seekMode == EXACT);
+    videoDecoder->setPaused(false);
+
+    // Restart audio output so it does not keep playing buffered audio from the old position
+    restoreItemAudio();
+    if (playing && audioStream) {
+        audioStream->stop();
+        audioStream->start();
+    }
+
+    notifyPositionChange();
+    return future;
+}
+
+void MediaPlayer::beginScrub() {
+    if (scrubbing || !videoDecoder->isOpen()) {
+        return;
+    }
+
+    // Silence audio and keep only the video decoder running, decoding keyframes only
+    playingBeforeScrub = playing;
+    if (playing) {
+        pause();
+    }
+
+    restoreItemAudio();
+
+    // Scrub frames must not complete an earlier asynchronous seek
+    replaceCompletion(nullptr);
+
+    scrubbing = true;
+    scrubPosition = currentPosition;
+    demuxer->setScrubbing(true);
+    videoDecoder->setKeyframesOnly(true);
+    videoDecoder->setPaused(false);
+}
+
+void MediaPlayer::scrubTo(double seconds) {
+    if (!scrubbing) {
+        return;
+    }
+
+    // Clamp position to valid range
+    scrubPosition = std::max(0.0, std::min(seconds, getDuration()));
+
+    currentPosition = scrubPosition;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        firstFramePending = true;
+    }
+
+    // Keyframe positioning that replaces any position the demuxer has not got to yet
+    demuxer->requestSeek(scrubPosition);
+    notifyPositionChange();
+}
+
+void MediaPlayer::endScrub() {
+    if (!scrubbing) {
+        return;
+    }
+
+    scrubbing = false;
+    demuxer->setScrubbing(false);
+    videoDecoder->setKeyframesOnly(false);
+
+    // One regular seek lands on the final position and decodes its exact frame, also while paused
+    seek(scrubPosition);
+
+    if (playingBeforeScrub) {
+        play();
+    }
+}
+
+bool MediaPlayer::isScrubbing() const {
+    return scrubbing;
+}
+
 void MediaPlayer::setVolume(float volume) {
     // Clamp volume to valid range
     if (volume < 0.0f) {
@@ -233,12 +611,110 @@ float MediaPlayer::getVolume() const {
     return volume;
 }
 
+bool MediaPlayer::setPlaylist(const std::vector<std::string>& filenames) {
+    clearPlaylist();
+    playlist = filenames;
+    return playItem(0);
+}
+
+void MediaPlayer::addToPlaylist(const std::string& filename) {
+    playlist.push_back(filename);
+}
+
+void MediaPlayer::clearPlaylist() {
+    // Nothing follows the current item any more, its audio must not move on to the preloaded one
+    if (audioStream) {
+        audioStream->setDecoder(audioDecoder.get(), itemSerial);
+    }
+
+    dropPreload();
+    playlist.clear();
+    playlistIndex = -1;
+}
+
+bool MediaPlayer::playItem(size_t index) {
+    if (index >= playlist.size()) {
+        return false;
+    }
+
+    // Items never loop, the end of one is where the next one starts
+    std::string filename = playlist[index];
+    if (!openFile(filename, false)) {
+        return false;
+    }
+
+    playlistIndex = static_cast<int>(index);
+    if (itemChangeCallback) {
+        itemChangeCallback(playlistIndex);
+    }
+
+    play();
+    return true;
+}
+
+bool MediaPlayer::playNext() {
+    return playlistIndex >= 0 && playItem(static_cast<size_t>(playlistIndex) + 1);
+}
+
+bool MediaPlayer::playPrevious() {
+    return playlistIndex > 0 && playItem(static_cast<size_t>(playlistIndex) - 1);
+}
+
+size_t MediaPlayer::getPlaylistSize() const {
+    return playlist.size();
+}
+
+int MediaPlayer::getPlaylistIndex() const {
+    return playlistIndex;
+}
+
+void MediaPlayer::setSeekMode(SeekMode mode) {
+    seekMode = mode;
+}
+
+MediaPlayer::SeekMode MediaPlayer::getSeekMode() const {
+    return seekMode;
+}
+
+void MediaPlayer::setInputMode(Demuxer::InputMode mode) {
+    inputMode = mode;
+}
+
+Demuxer::InputMode MediaPlayer::getInputMode() const {
+    return inputMode;
+}
+
+void MediaPlayer::setPrefetchWindow(size_t bytes) {
+    prefetchWindow = bytes;
+}
+
+size_t MediaPlayer::getPrefetchWindow() const {
+    return prefetchWindow;
+}
+
+MediaInput::Stats MediaPlayer::getInputStats() const {
+    if (!demuxer) {
+        return MediaInput::Stats{0, 0, 0, 0.0, 0.0};
+    }
+
+    return demuxer->getInputStats();
+}
+
+void MediaPlayer::setDecoderThreading(const DecoderThreading& threading) {
+    videoDecoder->setThreading(threading);
+    audioDecoder->setThreading(threading);
+}
+
+DecoderThreading MediaPlayer::getDecoderThreading() const {
+    return videoDecoder->getThreading();
+}
+
 bool MediaPlayer::isPlaying() const {
     return playing;
 }
 
 double MediaPlayer::getDuration() const {
-    return videoDecoder.getDuration();
+    return videoDecoder->getDuration();
 }
 
 double MediaPlayer::getCurrentPosition() const {
@@ -246,19 +722,152 @@ double MediaPlayer::getCurrentPosition() const {
 }
 
 sf::Vector2u MediaPlayer::getVideoSize() const {
-    return videoDecoder.getSize();
+    return videoDecoder->getSize();
 }
 
 double MediaPlayer::getFrameRate() const {
-    return videoDecoder.getFrameRate();
+    return videoDecoder->getFrameRate();
 }
 
 unsigned int MediaPlayer::getAudioSampleRate() const {
-    return audioDecoder.getSampleRate();
+    return audioDecoder->getSampleRate();
 }
 
 unsigned int MediaPlayer::getAudioChannelCount() const {
-    return audioDecoder.getChannelCount();
+    return audioDecoder->getChannelCount();
+}
+
+int MediaPlayer::getVideoDecoderThreadCount() const {
+    return videoDecoder->getThreadCount();
+}
+
+int MediaPlayer::getAudioDecoderThreadCount() const {
+    return audioDecoder->getThreadCount();
+}
+
+double MediaPlayer::getLastSeekLatency() const {
+    return lastSeekLatency;
+}
+
+int64_t MediaPlayer::getFrameNumber(double seconds) const {
+    std::shared_ptr<const PacketIndex> index = demuxer ? demuxer->getIndex() : nullptr;
+    int streamIndex = demuxer ? demuxer->findStream(AVMEDIA_TYPE_VIDEO) : -1;
+
+    if (!index || !index->hasStream(streamIndex)) {
+        return -1;
+    }
+
+    return index->getFrameNumber(streamIndex, seconds);
+}
+
+double MediaPlayer::getFrameTimestamp(int64_t frameNumber) const {
+    std::shared_ptr<const PacketIndex> index = demuxer ? demuxer->getIndex() : nullptr;
+    int streamIndex = demuxer ? demuxer->findStream(AVMEDIA_TYPE_VIDEO) : -1;
+
+    if (!index || !index->hasStream(streamIndex)) {
+        return -1.0;
+    }
+
+    return index->getFrameTimestamp(streamIndex, frameNumber);
+}
+
+MediaPlayer::SyncStats MediaPlayer::getSyncStats() const {
+    SyncStats stats;
+    stats.drift = syncDrift;
+    stats.presentedFrames = presentedFrames;
+    stats.droppedFrames = droppedFrames;
+    stats.audioClock = audioClockActive;
+    return stats;
+}
+
+MediaPlayer::StartupStats MediaPlayer::getStartupStats() const {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    StartupStats stats = startupStats;
+
+    // Milestones reached on the demuxing and audio threads are read from their timestamps
+    std::chrono::steady_clock::time_point time;
+    if (demuxer && demuxer->getFirstPacketTime(time)) {
+        stats.firstPacket = std::chrono::duration<double>(time - openStartTime).count();
+    }
+
+    if (audioStream && audioStream->getFirstChunkTime(time)) {
+        stats.firstAudio = std::chrono::duration<double>(time - openStartTime).count();
+    }
+
+    return stats;
+}
+
+MediaPlayer::Stats MediaPlayer::getStats() const {
+    Stats stats{};
+
+    // Decoder queues are only valid while a file is open
+    if (!openInProgress && videoDecoder->isOpen()) {
+        MediaDecoder::QueueStats video = videoDecoder->getQueueStats();
+        MediaDecoder::QueueStats audio = audioDecoder->getQueueStats();
+
+        stats.queuedFrames = video.decoded;
+        stats.queuedAudio = audio.decoded;
+        stats.queuedPackets = video.packets + audio.packets;
+        stats.queuedPacketBytes = video.packetBytes + audio.packetBytes;
+    }
+
+    MediaDecoder::StepStats videoSteps = videoDecoder->getStepStats();
+    MediaDecoder::StepStats audioSteps = audioDecoder->getStepStats();
+    stats.decodedFrames = videoSteps.decoded;
+    stats.presentedFrames = presentedFrames;
+    stats.droppedFrames = droppedFrames;
+    stats.decoderCpuTime = videoSteps.cpuTime + audioSteps.cpuTime;
+
+    stats.audioUnderruns = audioStream ? audioStream->getUnderrunCount() : 0;
+    stats.drift = syncDrift;
+
+    if (demuxer) {
+        stats.bytesRead = demuxer->getReadStats().bytes;
+        stats.coalescedSeeks = demuxer->getCoalescedSeekCount();
+    }
+
+    uint64_t completed = completedSeeks.load(std::memory_order_relaxed);
+    stats.seeks = seekCount.load(std::memory_order_relaxed);
+    stats.lastSeekLatency = lastSeekLatency;
+    stats.averageSeekLatency = completed > 0 ? totalSeekLatency.load(std::memory_order_relaxed) / completed : 0.0;
+    stats.maxSeekLatency = maxSeekLatency.load(std::memory_order_relaxed);
+
+    return stats;
+}
+
+MediaPlayer::StageLatencies MediaPlayer::getStageLatencies() const {
+    StageLatencies latencies;
+    VideoDecoder::StageLatencies video = videoDecoder->getStageLatencies();
+
+    latencies.demux = demuxer ? demuxer->getReadLatency() : LatencyHistogram::Summary{0, 0.0, 0.0, 0.0, 0.0};
+    latencies.decodeSend = video.send;
+    latencies.decodeReceive = video.receive;
+    latencies.queueWait = video.queueWait;
+    latencies.convert = video.convert;
+    latencies.upload = video.upload;
+    latencies.present = presentLatency.getSummary();
+    latencies.update = updateLatency.getSummary();
+    return latencies;
+}
+
+void MediaPlayer::setOutputSize(const sf::Vector2u& size) {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    videoDecoder->setOutputSize(size);
+}
+
+sf::Vector2u MediaPlayer::getOutputSize() const {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    return videoDecoder->getOutputSize();
+}
+
+void MediaPlayer::setScalingQuality(VideoDecoder::ScalingQuality quality) {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    videoDecoder->setScalingQuality(quality);
+}
+
+VideoDecoder::ScalingQuality MediaPlayer::getScalingQuality() const {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    return videoDecoder->getScalingQuality();
 }
 
 bool MediaPlayer::getCurrentFrame(sf::Texture& texture) {
@@ -268,30 +877,130 @@ bool MediaPlayer::getCurrentFrame(sf::Texture& texture) {
         return false;
     }
 
-    texture = currentFrame.texture;
+    // Convert and upload only the frame that is actually presented
+    bool converted = videoDecoder->convertFrameToTexture(currentFrame.frame.get(), texture);
+    currentFrame.frame.reset();
     newFrameAvailable = false;
 
-    return true;
+    if (converted) {
+        ++presentedFrames;
+        presentLatency.record(currentFrameTime);
+    }
+
+    return converted;
 }
 
 void MediaPlayer::update() {
+    auto updateStart = LatencyHistogram::now();
+
+    // Deliver errors the decoding threads reported since the last update
+    dispatchErrors();
+
+    // Finish an asynchronous open once its demuxer is ready
+    updatePendingOpen();
+
+    // Preload the next playlist item and switch to it at the end of the current one
+    updatePlaylist();
+
     // Update position if playing
     if (playing) {
         updatePosition();
     }
 
-    // Get next video frame if available
-    VideoFrame frame;
-    if (videoDecoder.getNextFrame(frame)) {
+    // Take the newest frame that is due on the master clock, frames it replaces are dropped before conversion
+    double clock = currentPosition;
+    bool frameReady = false;
+    bool firstFrameReady = false;
+    std::unique_ptr<Completion> completion;
+    double pts;
+
+    while (videoDecoder->peekNextFramePts(pts)) {
         std::lock_guard<std::mutex> lock(frameMutex);
-        currentFrame = frame;
-        newFrameAvailable = true;
 
-        // Call frame ready callback
-        if (frameReadyCallback) {
-            frameReadyCallback();
+        // Frames still queued for the old position must not stand in for a seek that is not performed yet
+        if (firstFramePending && demuxer && demuxer->isSeekPending()) {
+            break;
+        }
+
+        // A looping file starts over, the frame is far behind the previous one
+        bool looped = !firstFramePending && lastFramePts >= 0.0 && pts < lastFramePts - SYNC_RESET_THRESHOLD;
+        if (looped && clock > pts + SYNC_RESET_THRESHOLD) {
+            // The audio still plays the end of the file, the frame waits until the audio clock has looped too
+            if (audioClockActive) {
+                break;
+            }
+
+            // Without audio the clock starts over with the frame
+            currentPosition = pts;
+            positionClock.restart();
+            clock = pts;
+        }
+
+        bool discontinuity = pts - clock > SYNC_RESET_THRESHOLD;
+        if (!firstFramePending && !discontinuity && pts > clock + SYNC_LOOKAHEAD) {
+            break;
+        }
+
+        VideoFrame frame;
+        if (!videoDecoder->getNextFrame(frame)) {
+            break;
         }
+
+        if (newFrameAvailable) {
+            ++droppedFrames;
+        }
+
+        if (firstFramePending && lastSeekLatency < 0.0) {
+            double latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - seekStartTime).count();
+            lastSeekLatency = latency;
+
+            // Written only here, so the sum needs no read-modify-write
+            completedSeeks.fetch_add(1, std::memory_order_relaxed);
+            totalSeekLatency.store(totalSeekLatency.load(std::memory_order_relaxed) + latency, std::memory_order_relaxed);
+            if (latency > maxSeekLatency.load(std::memory_order_relaxed)) {
+                maxSeekLatency.store(latency, std::memory_order_relaxed);
+            }
+        }
+
+        if (firstFramePending) {
+            firstFrameReady = true;
+            completion = std::move(pendingCompletion);
+        }
+
+        if (startupStats.firstFrame < 0.0) {
+            startupStats.firstFrame = std::chrono::duration<double>(std::chrono::steady_clock::now() - openStartTime).count();
+        }
+
+        currentFrame = std::move(frame);
+        currentFrameTime = LatencyHistogram::now();
+        lastFramePts = pts;
+        newFrameAvailable = true;
+        firstFramePending = false;
+        frameReady = true;
+        syncDrift = pts - clock;
+    }
+
+    // The frame at a new position was only needed for display while paused
+    if (firstFrameReady && !playing && !scrubbing) {
+        videoDecoder->setPaused(true);
+    }
+
+    // The first frame is out, audio decoding no longer competes with it
+    if (firstFrameReady) {
+        startDeferredAudio();
     }
+
+    // Call frame ready callback
+    if (frameReady && frameReadyCallback) {
+        frameReadyCallback();
+    }
+
+    // Complete an asynchronous open or seek, outside the lock so the callback may use the player
+    if (completion) {
+        finishCompletion(std::move(completion), true);
+    }
+
+    updateLatency.record(updateStart);
 }
 
 void MediaPlayer::setPlaybackStartCallback(std::function<void()> callback) {
@@ -315,15 +1024,282 @@ void MediaPlayer::setFrameReadyCallback(std::function<void()> callback) {
 }
 
 void MediaPlayer::setErrorCallback(std::function<void(const MediaPlayerException&)> callback) {
-    ErrorHandler::getInstance().setErrorCallback(std::move(callback));
+    errorCallback = std::move(callback);
+}
+
+void MediaPlayer::setItemChangeCallback(std::function<void(int)> callback) {
+    itemChangeCallback = std::move(callback);
+}
+
+void MediaPlayer::beginStartup() {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    openStartTime = std::chrono::steady_clock::now();
+    startupStats = StartupStats{-1.0, -1.0, -1.0, -1.0, -1.0};
+}
+
+void MediaPlayer::recordStartupStage(double StartupStats::*stage) {
+    std::lock_guard<std::mutex> lock(frameMutex);
+    if (startupStats.*stage < 0.0) {
+        startupStats.*stage = std::chrono::duration<double>(std::chrono::steady_clock::now() - openStartTime).count();
+    }
+}
+
+void MediaPlayer::startDeferredAudio() {
+    if (!audioStartDeferred) {
+        return;
+    }
+
+    audioStartDeferred = false;
+    audioDecoder->start();
+}
+
+void MediaPlayer::updatePendingOpen() {
+    if (!pendingOpen.valid() || pendingOpen.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    std::shared_ptr<Demuxer> openedDemuxer = pendingOpen.get();
+    openInProgress = false;
+
+    // The completion stays pending until the first frame is ready
+    if (!openedDemuxer || !openDemuxer(std::move(openedDemuxer))) {
+        dispatchErrors();
+        replaceCompletion(nullptr);
+    }
+}
+
+void MediaPlayer::updatePlaylist() {
+    // Only files that do not loop come to an end
+    if (!demuxer || demuxer->isLooping() || !videoDecoder->isOpen()) {
+        return;
+    }
+
+    // Take the next item once it is open and decoding ahead, its audio follows the current item's without a gap
+    if (pendingPreload.valid() && pendingPreload.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        preloadedItem = pendingPreload.get();
+        preloadFailed = !preloadedItem;
+        queueNextAudio();
+    }
+
+    // Open the next item some time before the current one ends
+    int nextIndex = playlistIndex + 1;
+    bool hasNext = playlistIndex >= 0 && static_cast<size_t>(nextIndex) < playlist.size();
+    if (hasNext && !pendingPreload.valid() && !preloadedItem && !preloadFailed && getDuration() - currentPosition <= PRELOAD_AHEAD) {
+        startPreload(nextIndex);
+    }
+
+    if (!playing || scrubbing) {
+        return;
+    }
+
+    // The sound device is already playing the next item, video follows at once
+    double audioPosition;
+    uint64_t serial;
+    if (preloadedItem && audioStream && audioStream->getClock(audioPosition, serial) && serial != itemSerial) {
+        switchToPreloaded(audioPosition);
+        return;
+    }
+
+    if (!isItemFinished()) {
+        return;
+    }
+
+    if (preloadedItem) {
+        switchToPreloaded(-1.0);
+    } else if (hasNext && preloadFailed) {
+        // Opening in the background failed, a regular open reports why
+        playItem(static_cast<size_t>(nextIndex));
+    } else if (!hasNext) {
+        // End of the playlist, or of a file whose playlist was cleared
+        pause();
+        currentPosition = getDuration();
+        notifyPositionChange();
+    }
+}
+
+void MediaPlayer::startPreload(int index) {
+    // Settings of the current decoders carry over to the next item
+    std::string filename = playlist[index];
+    Demuxer::InputMode mode = inputMode;
+    size_t window = prefetchWindow;
+    DecoderThreading threading = videoDecoder->getThreading();
+    sf::Vector2u outputSize = getOutputSize();
+    VideoDecoder::ScalingQuality quality = getScalingQuality();
+
+    // Errors stay in the item's own channels, a failed item is opened again in the regular way which reports them
+    pendingPreload = std::async(std::launch::async, [=]() -> std::unique_ptr<PreloadedItem> {
+        auto item = std::make_unique<PreloadedItem>();
+        item->index = index;
+
+        item->demuxer = std::make_shared<Demuxer>();
+        item->demuxer->setLooping(false);
+        item->demuxer->setInputMode(mode);
+        item->demuxer->setPrefetchWindow(window);
+        if (!item->demuxer->open(filename)) {
+            return nullptr;
+        }
+
+        item->videoDecoder = std::make_unique<VideoDecoder>();
+        item->videoDecoder->setThreading(threading);
+        item->videoDecoder->setOutputSize(outputSize);
+        item->videoDecoder->setScalingQuality(quality);
+        if (!item->videoDecoder->open(item->demuxer) || !item->videoDecoder->initialize()) {
+            return nullptr;
+        }
+
+        // Audio is optional
+        item->audioDecoder = std::make_unique<AudioDecoder>();
+        item->audioDecoder->setThreading(threading);
+        if (!item->audioDecoder->open(item->demuxer) || !item->audioDecoder->initialize()) {
+            item->audioDecoder.reset();
+        }
+
+        // Decode ahead, both decoders wait once their output queues are full
+        item->videoDecoder->start();
+        if (item->audioDecoder) {
+            item->audioDecoder->start();
+        }
+
+        return item;
+    });
+}
+
+void MediaPlayer::dropPreload() {
+    // The worker cannot be interrupted, its item is released once it is done
+    if (pendingPreload.valid()) {
+        pendingPreload.wait();
+        pendingPreload = std::future<std::unique_ptr<PreloadedItem>>();
+    }
+
+    preloadedItem.reset();
+    preloadFailed = false;
+}
+
+void MediaPlayer::switchToPreloaded(double audioPosition) {
+    std::unique_ptr<PreloadedItem> item = std::move(preloadedItem);
+    uint64_t serial = itemSerial + 1;
+
+    // Audio output moves to the next item before the finished item's decoders are released
+    if (item->audioDecoder && audioStream) {
+        audioStream->setDecoder(item->audioDecoder.get(), serial);
+
+        // The stream has run dry if the finished item's audio ended before its video
+        if (audioStream->getStatus() != sf::SoundSource::Playing) {
+            audioStream->start();
+        }
+    } else if (item->audioDecoder) {
+        audioStream = std::make_unique<CustomAudioStream>(item->audioDecoder.get(), serial);
+        audioStream->setVolume(volume * 100.0f);
+        audioStream->start();
+    } else {
+        audioStream.reset();
+    }
+
+    // Output settings may have changed since the item was opened
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        item->videoDecoder->setOutputSize(videoDecoder->getOutputSize());
+        item->videoDecoder->setScalingQuality(videoDecoder->getScalingQuality());
+        lastFramePts = -1.0;
+    }
+
+    // Releasing the finished item joins its threads, they are idle at its end
+    DecoderThreading threading = videoDecoder->getThreading();
+    videoDecoder = std::move(item->videoDecoder);
+    audioDecoder = item->audioDecoder ? std::move(item->audioDecoder) : std::make_unique<AudioDecoder>();
+    audioDecoder->setThreading(threading);
+    demuxer = std::move(item->demuxer);
+
+    itemSerial = serial;
+    playlistIndex = item->index;
+    audioStartDeferred = false;
+
+    // Continue from what is being heard, or from the first frame of the new item
+    double firstPts;
+    currentPosition = audioPosition >= 0.0 ? audioPosition : (videoDecoder->peekNextFramePts(firstPts) ? firstPts : 0.0);
+    positionClock.restart();
+
+    if (itemChangeCallback) {
+        itemChangeCallback(playlistIndex);
+    }
+
+    notifyPositionChange();
+}
+
+void MediaPlayer::restoreItemAudio() {
+    // After a seek the current item's audio is played again. If the stream had already moved on to the
+    // preloaded item, that item has lost its first packets and is opened again.
+    if (audioStream && audioStream->setDecoder(audioDecoder.get(), itemSerial)) {
+        dropPreload();
+    }
+
+    queueNextAudio();
+}
+
+void MediaPlayer::queueNextAudio() {
+    if (audioStream) {
+        audioStream->queueDecoder(preloadedItem ? preloadedItem->audioDecoder.get() : nullptr, itemSerial + 1);
+    }
+}
+
+bool MediaPlayer::isItemFinished() {
+    // Audio that is still playing decides the end
+    if (audioStream && audioStream->getStatus() == sf::SoundSource::Playing) {
+        return false;
+    }
+
+    double pts;
+    if (!videoDecoder->isEndOfStream() || videoDecoder->peekNextFramePts(pts)) {
+        return false;
+    }
+
+    // The last frame stays on screen for one frame duration
+    double frameRate = videoDecoder->getFrameRate();
+    double end;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        end = lastFramePts + (frameRate > 0.0 ? 1.0 / frameRate : 0.0);
+    }
+
+    return currentPosition >= end;
+}
+
+void MediaPlayer::replaceCompletion(std::unique_ptr<Completion> completion) {
+    std::unique_ptr<Completion> superseded;
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        superseded = std::move(pendingCompletion);
+        pendingCompletion = std::move(completion);
+    }
+
+    if (superseded) {
+        finishCompletion(std::move(superseded), false);
+    }
+}
+
+void MediaPlayer::finishCompletion(std::unique_ptr<Completion> completion, bool success) {
+    completion->promise.set_value(success);
+
+    if (completion->callback) {
+        completion->callback(success);
+    }
 }
 
 void MediaPlayer::updatePosition() {
-    if (playing) {
-        // Update position based on elapsed time
+    // Audio of the next playlist item may already be heard before the switch, it is not this item's clock
+    double audioClock;
+    uint64_t serial;
+    if (playing && audioStream && audioStream->getClock(audioClock, serial) && serial == itemSerial) {
+        // Audio is the master clock, follow what is actually being heard
+        currentPosition.store(audioClock);
+        positionClock.restart();
+        audioClockActive = true;
+    } else if (playing) {
+        // Update position based on elapsed time until audio starts, or for files without audio
         double current = currentPosition.load();
         double newPosition = current + positionClock.restart().asSeconds();
         currentPosition.store(newPosition);
+        audioClockActive = false;
     }
 
     // Notify position change
@@ -335,3 +1311,33 @@ void MediaPlayer::notifyPositionChange() {
         positionChangeCallback(currentPosition);
     }
 }
+
+void MediaPlayer::dispatchErrors() {
+    MediaPlayerException::ErrorCode code;
+    std::string message;
+
+    // Channels are looked up for every error, closing the player releases the demuxer
+    while (errors.tryPop(code, message) || (demuxer && demuxer->getErrorChannel().tryPop(code, message)) ||
+           videoDecoder->getErrorChannel().tryPop(code, message) || audioDecoder->getErrorChannel().tryPop(code, message)) {
+        deliverError(MediaPlayerException(code, message));
+    }
+}
+
+void MediaPlayer::deliverError(const MediaPlayerException& error) {
+    // Always log the error
+    std::cerr << "Error: " << error.what() << std::endl;
+
+    if (errorCallback) {
+        errorCallback(error);
+        return;
+    }
+
+    // A failed open already leaves the player closed
+    if (openInProgress || !videoDecoder->isOpen()) {
+        return;
+    }
+
+    if (error.getCode() == MediaPlayerException::FILE_NOT_FOUND || error.getCode() == MediaPlayerException::DECODER_ERROR) {
+        close();
+    }
+}
@@ -3,20 +3,90 @@
 #include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
 #include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include "../include/AudioDecoder.hpp"
 #include "../include/VideoDecoder.hpp"
 
 class MediaPlayer {
  public:
+    // How seek() positions playback
+    enum SeekMode {
+        KEYFRAME,  // Resume at the keyframe before the position, fastest
+        EXACT      // Decode from the keyframe up to the position, output before it is skipped
+    };
+
+    // Audio/video synchronization counters
+    struct SyncStats {
+        double drift;            // Pts of the last presented frame minus the master clock, in seconds
+        size_t presentedFrames;  // Frames converted for display
+        size_t droppedFrames;    // Late frames dropped before conversion
+        bool audioClock;         // True when video follows the audio playback clock
+    };
+
+    // Time from open() or openAsync() to each startup milestone in seconds, negative until it is reached
+    struct StartupStats {
+        double probe;        // File opened and streams probed
+        double codecOpen;    // Video and audio codecs opened
+        double firstPacket;  // First packet read
+        double firstFrame;   // First video frame ready for getCurrentFrame()
+        double firstAudio;   // First audio handed to the sound device
+    };
+
+    // Snapshot of runtime counters since the file was opened, for monitoring
+    struct Stats {
+        // Queue depths
+        size_t queuedFrames;       // Decoded video frames waiting to be presented
+        size_t queuedAudio;        // Decoded audio packets waiting for the sound device
+        size_t queuedPackets;      // Demuxed video and audio packets waiting to be decoded
+        size_t queuedPacketBytes;  // Bytes of those packets
+
+        // Frames
+        uint64_t decodedFrames;  // Video frames decoded for presentation
+        size_t presentedFrames;  // Frames converted for display
+        size_t droppedFrames;    // Late frames dropped before conversion
+
+        // Audio and sync
+        uint64_t audioUnderruns;  // Times the sound device asked for audio before it was decoded
+        double drift;             // Pts of the last presented frame minus the master clock, in seconds
+
+        // Decoding and reading
+        double decoderCpuTime;  // CPU seconds of the video and audio decoding steps, without the codec's own threads
+        uint64_t bytesRead;     // Payload bytes of the packets read
+
+        // Seeks
+        uint64_t seeks;             // seek() and seekAsync() calls
+        uint64_t coalescedSeeks;    // Asynchronous seeks replaced by a newer one before being performed
+        double lastSeekLatency;     // Seconds from the last seek until its first frame, negative while pending
+        double averageSeekLatency;  // Over the seeks that reached their first frame
+        double maxSeekLatency;
+    };
+
+    // Latency of every stage a video frame passes since the file was opened, in seconds. Empty unless built with
+    // STAGE_HISTOGRAMS, see LatencyHistogram.
+    struct StageLatencies {
+        LatencyHistogram::Summary demux;          // av_read_frame() of one packet
+        LatencyHistogram::Summary decodeSend;     // avcodec_send_packet() of one video packet
+        LatencyHistogram::Summary decodeReceive;  // avcodec_receive_frame() returning a frame
+        LatencyHistogram::Summary queueWait;      // Decoded frame queued until update() took it
+        LatencyHistogram::Summary convert;        // Conversion to RGBA in getCurrentFrame()
+        LatencyHistogram::Summary upload;         // Texture creation and update in getCurrentFrame()
+        LatencyHistogram::Summary present;        // Frame taken by update() until getCurrentFrame() uploaded it
+        LatencyHistogram::Summary update;         // One update() call
+    };
+
     // Constructor/Destructor
     MediaPlayer();
     ~MediaPlayer();
 
-    // Media control methods
+    // Media control methods. open() and openAsync() play a single file and clear the playlist.
     bool open(const std::string& filename);
     void close();
     void play();
@@ -26,6 +96,51 @@ class MediaPlayer {
     void setVolume(float volume);
     float getVolume() const;
 
+    // Non-blocking open and seek. The returned future and the callback complete once the first frame at the
+    // new position is ready for getCurrentFrame(), with false on failure or when superseded by another
+    // open or seek. Progress happens in update() and callbacks run on the thread calling it.
+    std::future<bool> openAsync(const std::string& filename, std::function<void(bool)> callback = nullptr);
+    std::future<bool> seekAsync(double seconds, std::function<void(bool)> callback = nullptr);
+
+    // Playlist, items play back to back without a gap. Before the current item ends the next one is opened
+    // and starts decoding in the background, at the end of the current item playback switches over to it.
+    // setPlaylist() starts playing the first item. Clearing the playlist lets the current item play to its end.
+    bool setPlaylist(const std::vector<std::string>& filenames);
+    void addToPlaylist(const std::string& filename);
+    void clearPlaylist();
+    bool playItem(size_t index);
+    bool playNext();
+    bool playPrevious();
+    size_t getPlaylistSize() const;
+
+    // Index of the playing playlist item, -1 if the current file was not opened from the playlist
+    int getPlaylistIndex() const;
+
+    // Seek precision, EXACT by default
+    void setSeekMode(SeekMode mode);
+    SeekMode getSeekMode() const;
+
+    // Interactive scrubbing, e.g. while dragging a progress bar. scrubTo() never blocks, only the latest
+    // position is decoded and only its keyframe is shown. endScrub() seeks to the last position and
+    // restores the playback state from before beginScrub().
+    void beginScrub();
+    void scrubTo(double seconds);
+    void endScrub();
+    bool isScrubbing() const;
+
+    // How media files are read, takes effect on the next open()
+    void setInputMode(Demuxer::InputMode mode);
+    Demuxer::InputMode getInputMode() const;
+    void setPrefetchWindow(size_t bytes);
+    size_t getPrefetchWindow() const;
+
+    // Read counters of the current file's input, stalls show whether the prefetch window is large enough
+    MediaInput::Stats getInputStats() const;
+
+    // Decoder threading, takes effect on the next open()
+    void setDecoderThreading(const DecoderThreading& threading);
+    DecoderThreading getDecoderThreading() const;
+
     // Status methods
     bool isPlaying() const;
     double getDuration() const;
@@ -34,6 +149,28 @@ class MediaPlayer {
     double getFrameRate() const;
     unsigned int getAudioSampleRate() const;
     unsigned int getAudioChannelCount() const;
+    int getVideoDecoderThreadCount() const;
+    int getAudioDecoderThreadCount() const;
+    SyncStats getSyncStats() const;
+    StartupStats getStartupStats() const;
+    StageLatencies getStageLatencies() const;
+
+    // Cheap snapshot of every runtime counter, call from the thread that calls update()
+    Stats getStats() const;
+
+    // Seconds from the last seek() until its first frame was ready, negative while it is pending
+    double getLastSeekLatency() const;
+
+    // Convert between video frame numbers and seconds, -1 until the keyframe index is ready
+    int64_t getFrameNumber(double seconds) const;
+    double getFrameTimestamp(int64_t frameNumber) const;
+
+    // Display size frames are converted at, (0, 0) for the native video size.
+    // Call again whenever the display area is resized.
+    void setOutputSize(const sf::Vector2u& size);
+    sf::Vector2u getOutputSize() const;
+    void setScalingQuality(VideoDecoder::ScalingQuality quality);
+    VideoDecoder::ScalingQuality getScalingQuality() const;
 
     // Frame access methods
     bool getCurrentFrame(sf::Texture& texture);
@@ -45,24 +182,76 @@ class MediaPlayer {
     void setPlaybackStopCallback(std::function<void()> callback);
     void setPositionChangeCallback(std::function<void(double)> callback);
     void setFrameReadyCallback(std::function<void()> callback);
+
+    // Errors of this player only, called from update() or the failing call. Without a callback a decoding
+    // error closes the file.
     void setErrorCallback(std::function<void(const MediaPlayerException&)> callback);
 
+    // Called from update() when playback moves on to another playlist item
+    void setItemChangeCallback(std::function<void(int)> callback);
+
  private:
-    // Decoders
-    VideoDecoder videoDecoder;
-    AudioDecoder audioDecoder;
+    // Demuxer shared by both decoders
+    std::shared_ptr<Demuxer> demuxer;
+
+    // Decoders of the current file, replaced by the preloaded ones when the playlist moves on
+    std::unique_ptr<VideoDecoder> videoDecoder;
+    std::unique_ptr<AudioDecoder> audioDecoder;
 
     // Audio playback
     class CustomAudioStream : public sf::SoundStream {
      public:
-        CustomAudioStream(AudioDecoder& decoder);
+        CustomAudioStream(AudioDecoder* decoder, uint64_t serial);
         void start();
         void stop();
 
+        // Play from decoder and tag its chunks with serial, dropping a queued decoder. True if the stream
+        // was playing from another decoder.
+        bool setDecoder(AudioDecoder* decoder, uint64_t serial);
+
+        // Continue with decoder once the current one has played to the end of its file, nullptr for none
+        void queueDecoder(AudioDecoder* decoder, uint64_t serial);
+
+        // Get the pts of the sample being heard and the serial of its decoder, false until the first chunk plays
+        bool getClock(double& seconds, uint64_t& serial);
+
+        // Time the first chunk was handed to SFML, false until then
+        bool getFirstChunkTime(std::chrono::steady_clock::time_point& time);
+
+        // Number of chunk requests the decoder had no audio ready for, after the first chunk and before the end of the file
+        uint64_t getUnderrunCount() const;
+
      private:
-        AudioDecoder& audioDecoder;
+        // Pts of a chunk handed to SFML, the sample offset it starts at and the serial of its decoder
+        struct ChunkTiming {
+            sf::Uint64 firstSample;
+            double pts;
+            uint64_t serial;
+        };
+
+        // Current and queued decoder, guarded by decoderMutex
+        AudioDecoder* audioDecoder;
+        uint64_t decoderSerial;
+        AudioDecoder* nextDecoder;
+        uint64_t nextSerial;
+        std::mutex decoderMutex;
+
         std::vector<sf::Int16> buffer;
 
+        std::deque<ChunkTiming> chunkTimings;
+        sf::Uint64 samplesQueued;
+        std::chrono::steady_clock::time_point firstChunkTime;
+        bool firstChunkDelivered;
+        std::mutex timingMutex;
+
+        std::atomic<uint64_t> underruns;
+
+        // How long a chunk request waits for the decoder before the stream ends, covers decoder startup
+        static constexpr int DATA_WAIT_MS = 100;
+
+        // Next packet of the current decoder, switching to the queued one at the end of its file
+        bool getNextPacket(AudioPacket& packet);
+
         bool onGetData(Chunk& data) override;
         void onSeek(sf::Time timeOffset) override;
     };
@@ -78,7 +267,85 @@ class MediaPlayer {
     // Current frame
     VideoFrame currentFrame;
     bool newFrameAvailable;
-    std::mutex frameMutex;
+    bool firstFramePending;
+    mutable std::mutex frameMutex;
+
+    // Completion of an asynchronous open or seek
+    struct Completion {
+        std::promise<bool> promise;
+        std::function<void(bool)> callback;
+    };
+
+    // Demuxer being opened in the background by openAsync()
+    std::future<std::shared_ptr<Demuxer>> pendingOpen;
+    std::atomic<bool> openInProgress;
+    std::atomic<Demuxer::InputMode> inputMode;
+    std::atomic<size_t> prefetchWindow;
+
+    // Completes when the next first frame is taken in update(), guarded by frameMutex
+    std::unique_ptr<Completion> pendingCompletion;
+
+    // Startup timing of the current file, guarded by frameMutex
+    std::chrono::steady_clock::time_point openStartTime;
+    StartupStats startupStats;
+
+    // The audio decoder starts once the first video frame is ready or playback starts
+    bool audioStartDeferred;
+
+    // Next playlist item, opened and decoding ahead in the background
+    struct PreloadedItem {
+        int index;
+        std::shared_ptr<Demuxer> demuxer;
+        std::unique_ptr<VideoDecoder> videoDecoder;
+        std::unique_ptr<AudioDecoder> audioDecoder;  // nullptr without audio
+    };
+
+    // Playlist state
+    std::vector<std::string> playlist;
+    int playlistIndex;
+    std::future<std::unique_ptr<PreloadedItem>> pendingPreload;
+    std::unique_ptr<PreloadedItem> preloadedItem;
+    bool preloadFailed;
+
+    // Bumped for every file played, audio chunks carry it so the clock tells the next item from the current one
+    uint64_t itemSerial;
+
+    // Pts of the last frame taken for display, guarded by frameMutex. The current item has ended once the
+    // clock passes its end.
+    double lastFramePts;
+
+    // Seconds before the end of the current item the next one is opened
+    static constexpr double PRELOAD_AHEAD = 10.0;
+
+    // Seek state
+    std::atomic<SeekMode> seekMode;
+    std::atomic<bool> scrubbing;
+    bool playingBeforeScrub;
+    double scrubPosition;
+    std::atomic<double> lastSeekLatency;
+    std::atomic<uint64_t> seekCount;
+    std::atomic<uint64_t> completedSeeks;
+    std::atomic<double> totalSeekLatency;
+    std::atomic<double> maxSeekLatency;
+    std::chrono::steady_clock::time_point seekStartTime;
+
+    // Synchronization state
+    std::atomic<double> syncDrift;
+    std::atomic<size_t> presentedFrames;
+    std::atomic<size_t> droppedFrames;
+    std::atomic<bool> audioClockActive;
+
+    // Stage latencies measured by the player itself
+    LatencyHistogram::Clock::time_point currentFrameTime;  // When update() took currentFrame
+    LatencyHistogram presentLatency;
+    LatencyHistogram updateLatency;
+
+    // Frames up to this far ahead of the clock are presented early
+    static constexpr double SYNC_LOOKAHEAD = 0.005;
+
+    // Frames further ahead than this follow a discontinuity (seek) and are shown right away. Frames further
+    // behind the previous frame than this start the next loop of a looping file and restart the clock.
+    static constexpr double SYNC_RESET_THRESHOLD = 1.0;
 
     // Callbacks
     std::function<void()> playbackStartCallback;
@@ -86,8 +353,30 @@ class MediaPlayer {
     std::function<void()> playbackStopCallback;
     std::function<void(double)> positionChangeCallback;
     std::function<void()> frameReadyCallback;
+    std::function<void(int)> itemChangeCallback;
+    std::function<void(const MediaPlayerException&)> errorCallback;
+
+    // Errors of the asynchronous open worker, the demuxer and decoders each have their own channel
+    ErrorChannel errors;
 
     // Internal methods
+    bool openFile(const std::string& filename, bool looping);
+    bool openDemuxer(std::shared_ptr<Demuxer> openedDemuxer);
+    void replaceCompletion(std::unique_ptr<Completion> completion);
+    static void finishCompletion(std::unique_ptr<Completion> completion, bool success);
+    void updatePendingOpen();
+    void updatePlaylist();
+    void startPreload(int index);
+    void dropPreload();
+    void switchToPreloaded(double audioPosition);
+    void restoreItemAudio();
+    void queueNextAudio();
+    bool isItemFinished();
+    void beginStartup();
+    void recordStartupStage(double StartupStats::*stage);
+    void startDeferredAudio();
     void updatePosition();
     void notifyPositionChange();
+    void dispatchErrors();
+    void deliverError(const MediaPlayerException& error);
 };
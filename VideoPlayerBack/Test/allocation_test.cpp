@@ -0,0 +1,147 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../include/ErrorHandler.hpp"
+#include "../include/PacketQueue.hpp"
+#include "../include/SampleBufferPool.hpp"
+
+// Checks that the per-packet paths allocate nothing once warmed up: queueing demuxed packets, recycling audio
+// sample buffers and reporting errors. Every operator new in the process is counted.
+
+namespace {
+
+std::atomic<size_t> allocations(0);
+
+void* allocate(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+constexpr int WARMUP_ROUNDS = 100;
+constexpr int ROUNDS = 10000;
+constexpr int QUEUE_DEPTH = 32;
+
+// Reports a failed check, returns 1 to count it
+int check(bool passed, const char* name, size_t counted) {
+    std::printf("%s %s: %zu allocations\n", passed ? "ok  " : "FAIL", name, counted);
+    return passed ? 0 : 1;
+}
+
+// Fill the queue to QUEUE_DEPTH and drain it, like the demuxer running ahead of a decoder
+void cyclePackets(PacketQueue& queue, AVPacket* packet, int rounds) {
+    uint64_t epoch = 0;
+
+    for (int round = 0; round < rounds; ++round) {
+        for (int i = 0; i < QUEUE_DEPTH; ++i) {
+            packet->size = 1000 + i;
+            queue.push(packet, 0);
+        }
+
+        for (int i = 0; i < QUEUE_DEPTH; ++i) {
+            queue.pop(packet, epoch, std::chrono::milliseconds(0));
+            av_packet_unref(packet);
+        }
+    }
+}
+
+int checkPacketQueue() {
+    PacketQueue queue;
+    AVPacket* packet = av_packet_alloc();
+
+    cyclePackets(queue, packet, WARMUP_ROUNDS);
+    PacketQueue::PoolStats before = queue.getPoolStats();
+
+    size_t start = allocations.load();
+    cyclePackets(queue, packet, ROUNDS);
+    size_t counted = allocations.load() - start;
+
+    PacketQueue::PoolStats after = queue.getPoolStats();
+    av_packet_free(&packet);
+
+    // AVPackets come from av_malloc, the pool counters show whether any was allocated
+    return check(counted == 0 && after.misses == before.misses, "PacketQueue push/pop", counted);
+}
+
+int checkSampleBufferPool() {
+    SampleBufferPool pool(8);
+
+    auto cycle = [&pool](int rounds) {
+        for (int round = 0; round < rounds; ++round) {
+            std::vector<sf::Int16> samples = pool.acquire();
+            samples.resize(4096);
+            pool.release(std::move(samples));
+        }
+    };
+
+    cycle(WARMUP_ROUNDS);
+
+    size_t start = allocations.load();
+    cycle(ROUNDS);
+    size_t counted = allocations.load() - start;
+
+    return check(counted == 0, "SampleBufferPool acquire/release", counted);
+}
+
+int checkErrorChannel() {
+    ErrorChannel channel;
+    MediaPlayerException::ErrorCode code;
+    std::string popped;
+
+    // Messages are built before counting, reporting has to move them all the way through
+    std::vector<std::string> messages(ROUNDS, std::string("Error receiving frame from audio decoder: Invalid data"));
+
+    size_t start = allocations.load();
+    for (std::string& message : messages) {
+        channel.report(MediaPlayerException::DECODER_ERROR, std::move(message));
+        channel.tryPop(code, popped);
+    }
+    size_t counted = allocations.load() - start;
+
+    return check(counted == 0, "ErrorChannel report/tryPop", counted);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+    return allocate(size);
+}
+
+void* operator new[](size_t size) {
+    return allocate(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+int main() {
+    int failures = checkPacketQueue() + checkSampleBufferPool() + checkErrorChannel();
+
+    if (failures > 0) {
+        std::printf("%d check%s failed\n", failures, failures == 1 ? "" : "s");
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}
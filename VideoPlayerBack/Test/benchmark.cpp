@@ -0,0 +1,1162 @@
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../API/MediaPlayer.hpp"
+#include "../include/AudioDecoder.hpp"
+#include "../include/ColorConverter.hpp"
+#include "../include/DecodeExecutor.hpp"
+#include "../include/Demuxer.hpp"
+#include "../include/VideoDecoder.hpp"
+
+// Headless decode throughput benchmark. Every file is demuxed, decoded and converted to RGBA as fast as
+// possible, without a window or an audio device. Several players decode the same file at once with --players.
+// --scaling repeats every file with 1, 4, 16 and 32 players, --threads and --thread-type with each codec threading
+// setting, --input with each way of reading the file, --output-size and --scale-quality with each conversion size
+// and filter. --convert times the color conversion kernels on synthetic
+// frames of common sizes instead. --scrub drags a MediaPlayer across every file and counts the positions it was
+// asked for against the seeks it performed. --seek times seeks to the same positions in keyframe and exact mode.
+// --startup opens every file repeatedly and breaks down the time to its first frame.
+
+#ifndef BENCHMARK_MEDIA_DIR
+#define BENCHMARK_MEDIA_DIR "Test"
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Settings of one run of a file
+struct RunSettings {
+    int players = 1;
+    DecoderThreading threading;
+    Demuxer::InputMode inputMode = Demuxer::FILE_PROTOCOL;
+    sf::Vector2u outputSize;  // (0, 0) converts at the native size
+    VideoDecoder::ScalingQuality scalingQuality = VideoDecoder::BILINEAR;
+};
+
+// Process-wide I/O counters, read before and after a run
+struct IoCounters {
+    uint64_t readSyscalls = 0;
+    uint64_t storageBytes = 0;  // Bytes the kernel fetched from storage for the process
+    uint64_t minorFaults = 0;
+    uint64_t majorFaults = 0;
+};
+
+// One pipeline decoding a file to its end
+struct PipelineResult {
+    bool opened = false;
+    int codecThreads = 0;
+    sf::Vector2u convertedSize;  // Size of the last converted frame
+    uint64_t videoFrames = 0;
+    uint64_t audioPackets = 0;
+    double audioSeconds = 0.0;
+    double convertTime = 0.0;
+    Demuxer::ReadStats read{};
+    MediaInput::Stats input{};
+    FrameBufferPool::Stats bufferPool{};
+    MediaDecoder::StepStats videoSteps{};
+    MediaDecoder::StepStats audioSteps{};
+    std::vector<std::string> errors;
+};
+
+// Every player of a file together
+struct FileResult {
+    std::string filename;
+    RunSettings settings;
+    int codecThreads = 0;        // Threads the first player's video codec decodes with
+    sf::Vector2u convertedSize;  // Frames the first player converted, the RGBA that would be uploaded
+    int failedPlayers = 0;
+    uint64_t videoFrames = 0;
+    uint64_t audioPackets = 0;
+    double audioSeconds = 0.0;
+    double wallTime = 0.0;
+    double cpuTime = 0.0;
+    long peakRss = 0;  // KiB
+
+    // Reading of the file by every player together
+    uint64_t bytesDemuxed = 0;
+    MediaInput::Stats input{};  // Reads FFmpeg issued to a custom input, zero for the file protocol
+    IoCounters io;              // Difference over the run, including anything else the process did meanwhile
+
+    // Conversion buffers of every player together, a miss allocated a new buffer
+    uint64_t bufferHits = 0;
+    uint64_t bufferMisses = 0;
+    size_t bufferBytes = 0;  // Owned by the pools at the end of the run
+
+    // Microseconds per demuxed packet, decoded video frame, decoded audio packet and converted frame
+    double demuxPerPacket = 0.0;
+    double videoDecodePerFrame = 0.0;
+    double audioDecodePerPacket = 0.0;
+    double convertPerFrame = 0.0;
+};
+
+// Color conversion of one frame size and layout with one kernel set
+struct ConvertResult {
+    int width = 0;
+    int height = 0;
+    ColorConverter::PixelLayout layout = ColorConverter::YUV420P;
+    ColorConverter::Implementation implementation = ColorConverter::SCALAR;
+    uint64_t frames = 0;
+    double perFrame = 0.0;  // Microseconds
+};
+
+// Dragging the progress bar across a whole file during --scrub
+struct ScrubResult {
+    std::string filename;
+    bool opened = false;
+    uint64_t issued = 0;           // scrubTo() calls
+    uint64_t coalesced = 0;        // Positions replaced by a newer one before the demuxer got to them
+    uint64_t framesShown = 0;      // Keyframes delivered while dragging
+    double dragTime = 0.0;         // Seconds from the first scrubTo() to the keyframe of the last one
+    double catchUpLatency = -1.0;  // Last scrubTo() until its keyframe was delivered, negative on timeout
+    double settleLatency = -1.0;   // endScrub() until the exact frame at the final position, negative on timeout
+};
+
+// Seeks to spread positions in one seek mode during --seek
+struct SeekResult {
+    std::string filename;
+    MediaPlayer::SeekMode mode = MediaPlayer::EXACT;
+    bool opened = false;
+    uint64_t seeks = 0;
+    uint64_t timedOut = 0;        // Seeks without a frame within FRAME_TIMEOUT
+    double averageLatency = 0.0;  // Seconds from seek() until its first frame
+    double maxLatency = 0.0;
+};
+
+// Repeated opens of one file during --startup, stage times average the runs that reached the first frame
+struct StartupResult {
+    std::string filename;
+    int runs = 0;
+    int failedRuns = 0;
+    MediaPlayer::StartupStats first{};    // The first open, with whatever the page cache held before
+    MediaPlayer::StartupStats average{};  // Seconds since open() of each milestone
+};
+
+const char* const THREAD_TYPE_NAMES[] = {"frame", "slice", "both"};
+const char* const INPUT_MODE_NAMES[] = {"file", "mmap", "prefetch"};
+const char* const SCALING_QUALITY_NAMES[] = {"fast", "bilinear", "bicubic"};
+const char* const SEEK_MODE_NAMES[] = {"keyframe", "exact"};
+const char* const LAYOUT_NAMES[] = {"YUV420P", "NV12", "YUV422P"};
+const char* const IMPLEMENTATION_NAMES[] = {"scalar", "SSE4.1", "AVX2"};
+
+double getCpuTime() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+IoCounters getIoCounters() {
+    IoCounters counters;
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    counters.minorFaults = usage.ru_minflt;
+    counters.majorFaults = usage.ru_majflt;
+
+    // Linux only, the counters stay zero elsewhere
+    std::ifstream io("/proc/self/io");
+    std::string name;
+    uint64_t value;
+    while (io >> name >> value) {
+        if (name == "syscr:") {
+            counters.readSyscalls = value;
+        } else if (name == "read_bytes:") {
+            counters.storageBytes = value;
+        }
+    }
+
+    return counters;
+}
+
+long getPeakRss() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void collectErrors(ErrorChannel& channel, std::vector<std::string>& errors) {
+    MediaPlayerException::ErrorCode code;
+    std::string message;
+    while (channel.tryPop(code, message)) {
+        errors.push_back(message);
+    }
+}
+
+void runPipeline(const std::string& filename, const RunSettings& settings, PipelineResult& result) {
+    // Decoders are declared after the demuxer so they are stopped before it is closed
+    auto demuxer = std::make_shared<Demuxer>();
+    VideoDecoder video;
+    AudioDecoder audio;
+
+    // Read once to the end, the keyframe index would only add reads
+    demuxer->setLooping(false);
+    demuxer->setIndexing(false);
+    demuxer->setInputMode(settings.inputMode);
+
+    video.setThreading(settings.threading);
+    video.setOutputSize(settings.outputSize);
+    video.setScalingQuality(settings.scalingQuality);
+    audio.setThreading(settings.threading);
+
+    if (!demuxer->open(filename) || !video.open(demuxer) || !video.initialize()) {
+        collectErrors(demuxer->getErrorChannel(), result.errors);
+        collectErrors(video.getErrorChannel(), result.errors);
+        return;
+    }
+
+    bool hasAudio = audio.open(demuxer) && audio.initialize();
+    result.opened = true;
+    result.codecThreads = video.getThreadCount();
+
+    video.start();
+    if (hasAudio) {
+        audio.start();
+    }
+
+    bool videoDone = false;
+    bool audioDone = !hasAudio;
+
+    while (!videoDone || !audioDone) {
+        bool progress = false;
+
+        // Read before taking output, everything queued before the end was flagged is taken below
+        bool videoEnded = video.isEndOfStream();
+        bool audioEnded = !hasAudio || audio.isEndOfStream();
+
+        VideoFrame frame;
+        while (video.getNextFrame(frame)) {
+            sf::Vector2u size;
+            auto convertStart = Clock::now();
+            FrameBufferPool::Buffer buffer = video.convertFrame(frame.frame.get(), size);
+            result.convertTime += std::chrono::duration<double>(Clock::now() - convertStart).count();
+            result.convertedSize = size;
+
+            ++result.videoFrames;
+            progress = true;
+        }
+
+        AudioPacket packet;
+        while (hasAudio && audio.getNextPacket(packet)) {
+            result.audioSeconds += static_cast<double>(packet.samples.size()) / audio.getChannelCount() / audio.getSampleRate();
+            audio.recycleSamples(std::move(packet.samples));
+
+            ++result.audioPackets;
+            progress = true;
+        }
+
+        videoDone = videoEnded && !progress;
+        audioDone = audioEnded && !progress;
+
+        // Nothing was ready, decoding runs on the executor
+        if (!progress) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+
+    result.read = demuxer->getReadStats();
+    result.input = demuxer->getInputStats();
+    result.bufferPool = video.getBufferPoolStats();
+    result.videoSteps = video.getStepStats();
+    result.audioSteps = audio.getStepStats();
+
+    video.stop();
+    audio.stop();
+
+    collectErrors(demuxer->getErrorChannel(), result.errors);
+    collectErrors(video.getErrorChannel(), result.errors);
+    collectErrors(audio.getErrorChannel(), result.errors);
+}
+
+FileResult benchmarkFile(const std::string& filename, const RunSettings& settings) {
+    int players = settings.players;
+    std::vector<PipelineResult> results(players);
+    std::vector<std::thread> threads;
+
+    double cpuStart = getCpuTime();
+    IoCounters ioStart = getIoCounters();
+    auto wallStart = Clock::now();
+
+    for (int i = 0; i < players; ++i) {
+        threads.emplace_back(runPipeline, filename, std::cref(settings), std::ref(results[i]));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    FileResult file;
+    file.filename = filename;
+    file.settings = settings;
+    file.wallTime = std::chrono::duration<double>(Clock::now() - wallStart).count();
+    file.cpuTime = getCpuTime() - cpuStart;
+    file.peakRss = getPeakRss();
+
+    IoCounters ioEnd = getIoCounters();
+    file.io.readSyscalls = ioEnd.readSyscalls - ioStart.readSyscalls;
+    file.io.storageBytes = ioEnd.storageBytes - ioStart.storageBytes;
+    file.io.minorFaults = ioEnd.minorFaults - ioStart.minorFaults;
+    file.io.majorFaults = ioEnd.majorFaults - ioStart.majorFaults;
+
+    uint64_t packetsRead = 0;
+    double readTime = 0.0;
+    double videoDecodeTime = 0.0;
+    double audioDecodeTime = 0.0;
+    double convertTime = 0.0;
+
+    for (const PipelineResult& result : results) {
+        for (const std::string& error : result.errors) {
+            std::cerr << "Error: " << filename << ": " << error << std::endl;
+        }
+
+        if (!result.opened) {
+            ++file.failedPlayers;
+            continue;
+        }
+
+        if (file.codecThreads == 0) {
+            file.codecThreads = result.codecThreads;
+            file.convertedSize = result.convertedSize;
+        }
+
+        file.videoFrames += result.videoFrames;
+        file.audioPackets += result.audioPackets;
+        file.audioSeconds += result.audioSeconds;
+        packetsRead += result.read.packets;
+        file.bytesDemuxed += result.read.bytes;
+        file.input.reads += result.input.reads;
+        file.input.bytesRead += result.input.bytesRead;
+        file.input.stalls += result.input.stalls;
+        file.input.stallTime += result.input.stallTime;
+        file.input.maxStall = std::max(file.input.maxStall, result.input.maxStall);
+        file.bufferHits += result.bufferPool.hits;
+        file.bufferMisses += result.bufferPool.misses;
+        file.bufferBytes += result.bufferPool.allocatedBytes;
+        readTime += result.read.readTime;
+        videoDecodeTime += result.videoSteps.busyTime;
+        audioDecodeTime += result.audioSteps.busyTime;
+        convertTime += result.convertTime;
+    }
+
+    auto perUnit = [](double seconds, uint64_t count) { return count > 0 ? seconds * 1e6 / count : 0.0; };
+    file.demuxPerPacket = perUnit(readTime, packetsRead);
+    file.videoDecodePerFrame = perUnit(videoDecodeTime, file.videoFrames);
+    file.audioDecodePerPacket = perUnit(audioDecodeTime, file.audioPackets);
+    file.convertPerFrame = perUnit(convertTime, file.videoFrames);
+
+    return file;
+}
+
+// Converts one synthetic frame repeatedly for every size, layout and kernel set the CPU supports
+std::vector<ConvertResult> benchmarkConversion() {
+    const int sizes[][2] = {{640, 360}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+    const ColorConverter::PixelLayout layouts[] = {ColorConverter::YUV420P, ColorConverter::NV12, ColorConverter::YUV422P};
+    const double minTime = 0.25;
+
+    std::vector<ConvertResult> results;
+
+    for (const auto& size : sizes) {
+        int width = size[0];
+        int height = size[1];
+
+        for (ColorConverter::PixelLayout layout : layouts) {
+            int chromaHeight = layout == ColorConverter::YUV422P ? height : height / 2;
+            int stride[4] = {width, layout == ColorConverter::NV12 ? width : width / 2, layout == ColorConverter::NV12 ? 0 : width / 2, 0};
+
+            // A gradient with varying chroma, the kernels take no data-dependent branches
+            std::vector<uint8_t> planes[3];
+            for (int i = 0; i < 3; ++i) {
+                planes[i].resize(static_cast<size_t>(stride[i]) * (i == 0 ? height : chromaHeight));
+                for (size_t j = 0; j < planes[i].size(); ++j) {
+                    planes[i][j] = static_cast<uint8_t>(j * (i + 1));
+                }
+            }
+
+            const uint8_t* data[4] = {planes[0].data(), planes[1].data(), planes[2].empty() ? nullptr : planes[2].data(), nullptr};
+            std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+
+            for (int implementation = ColorConverter::SCALAR; implementation <= ColorConverter::detectImplementation(); ++implementation) {
+                ColorConverter converter;
+                converter.configure(layout, ColorConverter::BT709, ColorConverter::LIMITED);
+                converter.setImplementation(static_cast<ColorConverter::Implementation>(implementation));
+
+                // One untimed frame faults in the destination pages
+                converter.convert(data, stride, width, height, rgba.data(), width * 4);
+
+                ConvertResult result;
+                result.width = width;
+                result.height = height;
+                result.layout = layout;
+                result.implementation = converter.getImplementation();
+
+                auto start = Clock::now();
+                double elapsed = 0.0;
+                while (elapsed < minTime) {
+                    converter.convert(data, stride, width, height, rgba.data(), width * 4);
+                    ++result.frames;
+                    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+                }
+
+                result.perFrame = elapsed / result.frames * 1e6;
+                results.push_back(result);
+            }
+        }
+    }
+
+    return results;
+}
+
+// How long a MediaPlayer mode waits for a frame before it gives up on the file
+constexpr double FRAME_TIMEOUT = 10.0;
+
+// Pointer moves of one drag across the file and the time between them, a mouse reporting at 250 Hz
+constexpr int SCRUB_EVENTS = 250;
+constexpr std::chrono::milliseconds SCRUB_INTERVAL(4);
+
+// Seeks per file and seek mode
+constexpr int SEEK_COUNT = 20;
+
+// Opens per file, the first one may read from storage and the rest from the page cache
+constexpr int STARTUP_RUNS = 5;
+
+// Call update() like a render loop until done() holds, false when FRAME_TIMEOUT passes first
+template <typename Condition>
+bool updateUntil(MediaPlayer& player, Condition done) {
+    auto start = Clock::now();
+
+    while (!done()) {
+        if (std::chrono::duration<double>(Clock::now() - start).count() > FRAME_TIMEOUT) {
+            return false;
+        }
+
+        player.update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+// Drags from the start to the end of the file without presenting frames, then releases at the end
+ScrubResult benchmarkScrub(const std::string& filename) {
+    ScrubResult result;
+    result.filename = filename;
+
+    MediaPlayer player;
+    uint64_t frames = 0;
+    player.setFrameReadyCallback([&frames] { ++frames; });
+
+    if (!player.open(filename) || !updateUntil(player, [&player] { return player.getStartupStats().firstFrame >= 0.0; })) {
+        return result;
+    }
+
+    result.opened = true;
+    double duration = player.getDuration();
+
+    player.beginScrub();
+    frames = 0;
+    auto dragStart = Clock::now();
+
+    for (int i = 1; i <= SCRUB_EVENTS; ++i) {
+        player.scrubTo(duration * i / SCRUB_EVENTS);
+        ++result.issued;
+
+        player.update();
+        std::this_thread::sleep_for(SCRUB_INTERVAL);
+    }
+
+    // Frames of older positions are discarded by their seek epoch, the next one delivered is the last position's
+    auto lastScrub = Clock::now();
+    uint64_t framesBefore = frames;
+    if (updateUntil(player, [&] { return frames > framesBefore; })) {
+        result.catchUpLatency = std::chrono::duration<double>(Clock::now() - lastScrub).count();
+    }
+
+    result.dragTime = std::chrono::duration<double>(Clock::now() - dragStart).count();
+    result.framesShown = frames;
+
+    // An explicit seek does not count the request it replaces, read the counter before releasing
+    result.coalesced = player.getStats().coalescedSeeks;
+
+    player.endScrub();
+    if (updateUntil(player, [&player] { return player.getLastSeekLatency() >= 0.0; })) {
+        result.settleLatency = player.getLastSeekLatency();
+    }
+
+    return result;
+}
+
+// Seeks to the same pseudo-random positions in every mode, each one waits for its frame like a paused player
+SeekResult benchmarkSeek(const std::string& filename, MediaPlayer::SeekMode mode) {
+    SeekResult result;
+    result.filename = filename;
+    result.mode = mode;
+
+    MediaPlayer player;
+    player.setSeekMode(mode);
+
+    if (!player.open(filename) || !updateUntil(player, [&player] { return player.getStartupStats().firstFrame >= 0.0; })) {
+        return result;
+    }
+
+    result.opened = true;
+    double duration = player.getDuration();
+    std::mt19937 random(20240705);
+
+    for (int i = 0; i < SEEK_COUNT; ++i) {
+        player.seek(std::uniform_real_distribution<double>(0.0, duration)(random));
+        if (!updateUntil(player, [&player] { return player.getLastSeekLatency() >= 0.0; })) {
+            ++result.timedOut;
+        }
+    }
+
+    MediaPlayer::Stats stats = player.getStats();
+    result.seeks = stats.seeks;
+    result.averageLatency = stats.averageSeekLatency;
+    result.maxLatency = stats.maxSeekLatency;
+
+    return result;
+}
+
+// Opens the file STARTUP_RUNS times, each until its first frame. Playback is not started, so the first audio
+// milestone is not reached.
+StartupResult benchmarkStartup(const std::string& filename) {
+    StartupResult result;
+    result.filename = filename;
+
+    int completed = 0;
+
+    for (int i = 0; i < STARTUP_RUNS; ++i) {
+        ++result.runs;
+
+        MediaPlayer player;
+        if (!player.open(filename) || !updateUntil(player, [&player] { return player.getStartupStats().firstFrame >= 0.0; })) {
+            ++result.failedRuns;
+            continue;
+        }
+
+        MediaPlayer::StartupStats stats = player.getStartupStats();
+        if (completed == 0) {
+            result.first = stats;
+        }
+
+        result.average.probe += stats.probe;
+        result.average.codecOpen += stats.codecOpen;
+        result.average.firstPacket += stats.firstPacket;
+        result.average.firstFrame += stats.firstFrame;
+        ++completed;
+    }
+
+    if (completed > 0) {
+        result.average.probe /= completed;
+        result.average.codecOpen /= completed;
+        result.average.firstPacket /= completed;
+        result.average.firstFrame /= completed;
+    }
+
+    return result;
+}
+
+std::string escapeJson(const std::string& text) {
+    std::string escaped;
+
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char code[8];
+            std::snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+// Players, codec threading, input and conversion of a run, e.g. "4 players, auto threads (2 active), frame, mmap, 1280x720 fast"
+std::string describeSettings(const FileResult& file) {
+    char description[192];
+    char threads[32];
+    char output[48];
+
+    if (file.settings.threading.threadCount > 0) {
+        std::snprintf(threads, sizeof(threads), "%d", file.settings.threading.threadCount);
+    } else {
+        std::snprintf(threads, sizeof(threads), "auto");
+    }
+
+    // The filter only matters when frames are scaled
+    if (file.settings.outputSize.x > 0 && file.settings.outputSize.y > 0) {
+        std::snprintf(output, sizeof(output), "%ux%u %s", file.settings.outputSize.x, file.settings.outputSize.y,
+                      SCALING_QUALITY_NAMES[file.settings.scalingQuality]);
+    } else {
+        std::snprintf(output, sizeof(output), "native");
+    }
+
+    std::snprintf(description, sizeof(description), "%d player%s, %s threads (%d active), %s, %s, %s", file.settings.players,
+                  file.settings.players == 1 ? "" : "s", threads, file.codecThreads, THREAD_TYPE_NAMES[file.settings.threading.type],
+                  INPUT_MODE_NAMES[file.settings.inputMode], output);
+    return description;
+}
+
+void printResult(std::FILE* out, const FileResult& file) {
+    double fps = file.wallTime > 0.0 ? file.videoFrames / file.wallTime : 0.0;
+
+    std::fprintf(out, "%s (%s)\n", file.filename.c_str(), describeSettings(file).c_str());
+    if (file.failedPlayers > 0) {
+        std::fprintf(out, "  failed to open in %d player%s\n", file.failedPlayers, file.failedPlayers == 1 ? "" : "s");
+    }
+    std::fprintf(out, "  %llu frames, %.1f s audio in %.3f s: %.1f fps\n", static_cast<unsigned long long>(file.videoFrames), file.audioSeconds,
+                 file.wallTime, fps);
+    std::fprintf(out, "  demux %.1f us/packet, video decode %.1f us/frame, audio decode %.1f us/packet, convert %.1f us/frame\n", file.demuxPerPacket,
+                 file.videoDecodePerFrame, file.audioDecodePerPacket, file.convertPerFrame);
+    std::fprintf(out, "  converted to %ux%u, %.2f MB per frame\n", file.convertedSize.x, file.convertedSize.y,
+                 file.convertedSize.x * file.convertedSize.y * 4 / 1e6);
+    std::fprintf(out, "  CPU %.3f s, peak RSS %.1f MiB\n", file.cpuTime, file.peakRss / 1024.0);
+
+    uint64_t acquired = file.bufferHits + file.bufferMisses;
+    std::fprintf(out, "  frame buffers: %llu hits, %llu misses, %.1f%% recycled, %.1f MiB pooled\n", static_cast<unsigned long long>(file.bufferHits),
+                 static_cast<unsigned long long>(file.bufferMisses), acquired > 0 ? 100.0 * file.bufferHits / acquired : 0.0,
+                 file.bufferBytes / (1024.0 * 1024.0));
+    std::fprintf(out, "  input %s: %.1f MB/s demuxed, %llu read syscalls, %llu input reads, %llu minor / %llu major faults, %.1f MB from storage\n",
+                 INPUT_MODE_NAMES[file.settings.inputMode], file.wallTime > 0.0 ? file.bytesDemuxed / file.wallTime / 1e6 : 0.0,
+                 static_cast<unsigned long long>(file.io.readSyscalls), static_cast<unsigned long long>(file.input.reads),
+                 static_cast<unsigned long long>(file.io.minorFaults), static_cast<unsigned long long>(file.io.majorFaults),
+                 file.io.storageBytes / 1e6);
+
+    // The file protocol is not timed, only the custom inputs count stalled reads
+    if (file.settings.inputMode != Demuxer::FILE_PROTOCOL) {
+        std::fprintf(out, "  input stalls: %llu, %.1f ms total, longest %.2f ms\n", static_cast<unsigned long long>(file.input.stalls),
+                     file.input.stallTime * 1000.0, file.input.maxStall * 1000.0);
+    }
+}
+
+void printConversion(std::FILE* out, const ConvertResult& result) {
+    double megapixels = result.perFrame > 0.0 ? static_cast<double>(result.width) * result.height / result.perFrame : 0.0;
+
+    std::fprintf(out, "%dx%d %-7s %-6s: %8.1f us/frame, %7.1f Mpixel/s\n", result.width, result.height, LAYOUT_NAMES[result.layout],
+                 IMPLEMENTATION_NAMES[result.implementation], result.perFrame, megapixels);
+}
+
+void printScrub(std::FILE* out, const ScrubResult& result) {
+    std::fprintf(out, "%s (scrub)\n", result.filename.c_str());
+    if (!result.opened) {
+        std::fprintf(out, "  failed to open or show the first frame\n");
+        return;
+    }
+
+    std::fprintf(out, "  %llu positions issued, %llu seeks executed, %llu coalesced, %llu keyframes shown in %.3f s\n",
+                 static_cast<unsigned long long>(result.issued), static_cast<unsigned long long>(result.issued - result.coalesced),
+                 static_cast<unsigned long long>(result.coalesced), static_cast<unsigned long long>(result.framesShown), result.dragTime);
+    std::fprintf(out, "  last position shown after %.1f ms, exact frame after release %.1f ms\n", result.catchUpLatency * 1000.0,
+                 result.settleLatency * 1000.0);
+}
+
+std::string toScrubJson(const std::vector<ScrubResult>& results) {
+    std::ostringstream json;
+
+    json << "{\n";
+    json << "  \"scrub\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ScrubResult& result = results[i];
+
+        json << (i > 0 ? "," : "") << "\n    {\"file\": \"" << escapeJson(result.filename) << "\", \"opened\": " << (result.opened ? "true" : "false")
+             << ", \"issued\": " << result.issued << ", \"executed\": " << result.issued - result.coalesced << ", \"coalesced\": " << result.coalesced
+             << ", \"framesShown\": " << result.framesShown << ", \"dragSeconds\": " << result.dragTime
+             << ", \"catchUpSeconds\": " << result.catchUpLatency << ", \"settleSeconds\": " << result.settleLatency << "}";
+    }
+
+    json << "\n  ]\n";
+    json << "}\n";
+
+    return json.str();
+}
+
+void printSeek(std::FILE* out, const SeekResult& result) {
+    std::fprintf(out, "%s (%s seek)\n", result.filename.c_str(), SEEK_MODE_NAMES[result.mode]);
+    if (!result.opened) {
+        std::fprintf(out, "  failed to open or show the first frame\n");
+        return;
+    }
+
+    std::fprintf(out, "  %llu seeks: average %.1f ms, max %.1f ms until the first frame", static_cast<unsigned long long>(result.seeks),
+                 result.averageLatency * 1000.0, result.maxLatency * 1000.0);
+    if (result.timedOut > 0) {
+        std::fprintf(out, ", %llu timed out", static_cast<unsigned long long>(result.timedOut));
+    }
+    std::fprintf(out, "\n");
+}
+
+std::string toSeekJson(const std::vector<SeekResult>& results) {
+    std::ostringstream json;
+
+    json << "{\n";
+    json << "  \"seek\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const SeekResult& result = results[i];
+
+        json << (i > 0 ? "," : "") << "\n    {\"file\": \"" << escapeJson(result.filename) << "\", \"mode\": \"" << SEEK_MODE_NAMES[result.mode]
+             << "\", \"opened\": " << (result.opened ? "true" : "false") << ", \"seeks\": " << result.seeks << ", \"timedOut\": " << result.timedOut
+             << ", \"averageSeconds\": " << result.averageLatency << ", \"maxSeconds\": " << result.maxLatency << "}";
+    }
+
+    json << "\n  ]\n";
+    json << "}\n";
+
+    return json.str();
+}
+
+// Milestones in milliseconds since open(), e.g. "probe 12.1, codecs 20.4, first packet 13.0, first frame 31.7 ms"
+std::string describeStartup(const MediaPlayer::StartupStats& stats) {
+    char description[128];
+    std::snprintf(description, sizeof(description), "probe %.1f, codecs %.1f, first packet %.1f, first frame %.1f ms", stats.probe * 1000.0,
+                  stats.codecOpen * 1000.0, stats.firstPacket * 1000.0, stats.firstFrame * 1000.0);
+    return description;
+}
+
+void printStartup(std::FILE* out, const StartupResult& result) {
+    std::fprintf(out, "%s (startup)\n", result.filename.c_str());
+    if (result.failedRuns == result.runs) {
+        std::fprintf(out, "  failed to open or show the first frame\n");
+        return;
+    }
+
+    if (result.failedRuns > 0) {
+        std::fprintf(out, "  %d of %d opens failed\n", result.failedRuns, result.runs);
+    }
+    std::fprintf(out, "  first open: %s\n", describeStartup(result.first).c_str());
+    std::fprintf(out, "  average of %d: %s\n", result.runs - result.failedRuns, describeStartup(result.average).c_str());
+}
+
+// Average milestones over the files that opened, each file weighted once
+void printStartupSummary(std::FILE* out, const std::vector<StartupResult>& results) {
+    MediaPlayer::StartupStats total{};
+    int files = 0;
+
+    for (const StartupResult& result : results) {
+        if (result.failedRuns < result.runs) {
+            total.probe += result.average.probe;
+            total.codecOpen += result.average.codecOpen;
+            total.firstPacket += result.average.firstPacket;
+            total.firstFrame += result.average.firstFrame;
+            ++files;
+        }
+    }
+
+    if (files > 1) {
+        total.probe /= files;
+        total.codecOpen /= files;
+        total.firstPacket /= files;
+        total.firstFrame /= files;
+        std::fprintf(out, "Corpus of %d files: %s\n", files, describeStartup(total).c_str());
+    }
+}
+
+std::string toStartupJson(const std::vector<StartupResult>& results) {
+    std::ostringstream json;
+
+    auto stages = [&json](const MediaPlayer::StartupStats& stats) {
+        json << "{\"probe\": " << stats.probe << ", \"codecOpen\": " << stats.codecOpen << ", \"firstPacket\": " << stats.firstPacket
+             << ", \"firstFrame\": " << stats.firstFrame << "}";
+    };
+
+    json << "{\n";
+    json << "  \"startup\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const StartupResult& result = results[i];
+
+        json << (i > 0 ? "," : "") << "\n    {\"file\": \"" << escapeJson(result.filename) << "\", \"runs\": " << result.runs
+             << ", \"failedRuns\": " << result.failedRuns << ", \"firstSeconds\": ";
+        stages(result.first);
+        json << ", \"averageSeconds\": ";
+        stages(result.average);
+        json << "}";
+    }
+
+    json << "\n  ]\n";
+    json << "}\n";
+
+    return json.str();
+}
+
+std::string toConversionJson(const std::vector<ConvertResult>& results) {
+    std::ostringstream json;
+
+    json << "{\n";
+    json << "  \"conversion\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ConvertResult& result = results[i];
+
+        json << (i > 0 ? "," : "") << "\n    {\"width\": " << result.width << ", \"height\": " << result.height << ", \"layout\": \""
+             << LAYOUT_NAMES[result.layout] << "\", \"implementation\": \"" << IMPLEMENTATION_NAMES[result.implementation]
+             << "\", \"frames\": " << result.frames << ", \"usPerFrame\": " << result.perFrame << "}";
+    }
+
+    json << "\n  ]\n";
+    json << "}\n";
+
+    return json.str();
+}
+
+bool writeJson(const std::string& json, const std::string& path) {
+    if (path == "-") {
+        std::cout << json;
+        return true;
+    }
+
+    std::ofstream output(path);
+    output << json;
+    if (!output) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Throughput of every run of one file against its first run
+void printComparison(std::FILE* out, const std::vector<FileResult>& results, const std::string& filename) {
+    double firstFps = 0.0;
+
+    std::fprintf(out, "Runs of %s\n", filename.c_str());
+    for (const FileResult& file : results) {
+        if (file.filename != filename) {
+            continue;
+        }
+
+        double fps = file.wallTime > 0.0 ? file.videoFrames / file.wallTime : 0.0;
+        if (firstFps == 0.0) {
+            firstFps = fps;
+        }
+
+        std::fprintf(out, "  %-64s %8.1f fps, %7.1f fps per player, convert %7.1f us/frame", describeSettings(file).c_str(), fps,
+                     fps / file.settings.players, file.convertPerFrame);
+        if (firstFps > 0.0) {
+            std::fprintf(out, ", %.2fx first run", fps / firstFps);
+        }
+        std::fprintf(out, "\n");
+    }
+}
+
+std::string toJson(const std::vector<FileResult>& files, double wallTime, double cpuTime) {
+    std::ostringstream json;
+    uint64_t totalFrames = 0;
+
+    json << "{\n";
+    json << "  \"executorWorkers\": " << DecodeExecutor::getShared().getWorkerCount() << ",\n";
+    json << "  \"files\": [";
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        const FileResult& file = files[i];
+        totalFrames += file.videoFrames;
+
+        json << (i > 0 ? "," : "") << "\n    {\n";
+        json << "      \"file\": \"" << escapeJson(file.filename) << "\",\n";
+        json << "      \"players\": " << file.settings.players << ",\n";
+        json << "      \"threads\": " << file.settings.threading.threadCount << ",\n";
+        json << "      \"threadType\": \"" << THREAD_TYPE_NAMES[file.settings.threading.type] << "\",\n";
+        json << "      \"codecThreads\": " << file.codecThreads << ",\n";
+        json << "      \"input\": \"" << INPUT_MODE_NAMES[file.settings.inputMode] << "\",\n";
+        json << "      \"outputSize\": [" << file.settings.outputSize.x << ", " << file.settings.outputSize.y << "],\n";
+        json << "      \"scaleQuality\": \"" << SCALING_QUALITY_NAMES[file.settings.scalingQuality] << "\",\n";
+        json << "      \"convertedSize\": [" << file.convertedSize.x << ", " << file.convertedSize.y << "],\n";
+        json << "      \"failedPlayers\": " << file.failedPlayers << ",\n";
+        json << "      \"frames\": " << file.videoFrames << ",\n";
+        json << "      \"audioPackets\": " << file.audioPackets << ",\n";
+        json << "      \"audioSeconds\": " << file.audioSeconds << ",\n";
+        json << "      \"wallSeconds\": " << file.wallTime << ",\n";
+        json << "      \"fps\": " << (file.wallTime > 0.0 ? file.videoFrames / file.wallTime : 0.0) << ",\n";
+        json << "      \"usPerUnit\": {\"demuxPacket\": " << file.demuxPerPacket << ", \"videoDecodeFrame\": " << file.videoDecodePerFrame
+             << ", \"audioDecodePacket\": " << file.audioDecodePerPacket << ", \"convertFrame\": " << file.convertPerFrame << "},\n";
+        json << "      \"io\": {\"bytesDemuxed\": " << file.bytesDemuxed << ", \"readSyscalls\": " << file.io.readSyscalls
+             << ", \"inputReads\": " << file.input.reads << ", \"minorFaults\": " << file.io.minorFaults
+             << ", \"majorFaults\": " << file.io.majorFaults << ", \"storageBytes\": " << file.io.storageBytes
+             << ", \"stalls\": " << file.input.stalls << ", \"stallSeconds\": " << file.input.stallTime
+             << ", \"maxStallSeconds\": " << file.input.maxStall << "},\n";
+        json << "      \"bufferPool\": {\"hits\": " << file.bufferHits << ", \"misses\": " << file.bufferMisses << ", \"bytes\": " << file.bufferBytes
+             << "},\n";
+        json << "      \"cpuSeconds\": " << file.cpuTime << ",\n";
+        json << "      \"peakRssKiB\": " << file.peakRss << "\n";
+        json << "    }";
+    }
+
+    json << "\n  ],\n";
+    json << "  \"total\": {\"frames\": " << totalFrames << ", \"wallSeconds\": " << wallTime
+         << ", \"fps\": " << (wallTime > 0.0 ? totalFrames / wallTime : 0.0) << ", \"cpuSeconds\": " << cpuTime
+         << ", \"peakRssKiB\": " << getPeakRss() << "}\n";
+    json << "}\n";
+
+    return json.str();
+}
+
+// Comma-separated list of counts, e.g. "1,2,4,0"
+std::vector<int> parseCounts(const char* text) {
+    std::vector<int> counts;
+    std::stringstream stream(text);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+        counts.push_back(std::max(0, std::atoi(item.c_str())));
+    }
+
+    return counts;
+}
+
+// Comma-separated list of sizes, e.g. "1280x720,0x0", 0x0 for the native size. Empty on a malformed size.
+std::vector<sf::Vector2u> parseSizes(const char* text) {
+    std::vector<sf::Vector2u> sizes;
+    std::stringstream stream(text);
+    std::string item;
+
+    while (std::getline(stream, item, ',')) {
+        unsigned int width;
+        unsigned int height;
+        char separator;
+        std::istringstream size(item);
+
+        if (!(size >> width >> separator >> height) || separator != 'x') {
+            return {};
+        }
+
+        sizes.emplace_back(width, height);
+    }
+
+    return sizes;
+}
+
+// Every run once with each value, set on the run by apply
+template <typename Value, typename Apply>
+void expandRuns(std::vector<RunSettings>& runs, const std::vector<Value>& values, Apply apply) {
+    std::vector<RunSettings> expanded;
+
+    for (const RunSettings& run : runs) {
+        for (const Value& value : values) {
+            expanded.push_back(run);
+            apply(expanded.back(), value);
+        }
+    }
+
+    runs = std::move(expanded);
+}
+
+// Comma-separated list of names from names, as their enum values. False on an unknown name.
+template <typename Enum, size_t COUNT>
+bool parseNames(const char* text, const char* const (&names)[COUNT], std::vector<Enum>& values) {
+    std::stringstream stream(text);
+    std::string item;
+
+    values.clear();
+    while (std::getline(stream, item, ',')) {
+        auto name = std::find_if(std::begin(names), std::end(names), [&](const char* candidate) { return item == candidate; });
+        if (name == std::end(names)) {
+            return false;
+        }
+
+        values.push_back(static_cast<Enum>(name - std::begin(names)));
+    }
+
+    return !values.empty();
+}
+
+std::vector<std::string> findDefaultFiles() {
+    std::vector<std::string> files;
+
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(BENCHMARK_MEDIA_DIR, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() == ".mp4") {
+            files.push_back(it->path().string());
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> files;
+    std::string jsonPath;
+    std::vector<int> playerCounts = {1};
+    std::vector<int> threadCounts = {DecoderThreading().threadCount};
+    std::vector<DecoderThreading::Type> threadTypes = {DecoderThreading().type};
+    std::vector<Demuxer::InputMode> inputModes = {Demuxer::FILE_PROTOCOL};
+    std::vector<sf::Vector2u> outputSizes = {sf::Vector2u(0, 0)};
+    std::vector<VideoDecoder::ScalingQuality> scalingQualities = {VideoDecoder::BILINEAR};
+    bool conversion = false;
+    bool scrub = false;
+    bool seek = false;
+    bool startup = false;
+    bool showUsage = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            playerCounts = {std::max(1, std::atoi(argv[++i]))};
+        } else if (std::strcmp(argv[i], "--scaling") == 0) {
+            playerCounts = {1, 4, 16, 32};
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCounts = parseCounts(argv[++i]);
+            showUsage = threadCounts.empty();
+        } else if (std::strcmp(argv[i], "--thread-type") == 0 && i + 1 < argc) {
+            showUsage = !parseNames(argv[++i], THREAD_TYPE_NAMES, threadTypes);
+        } else if (std::strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            showUsage = !parseNames(argv[++i], INPUT_MODE_NAMES, inputModes);
+        } else if (std::strcmp(argv[i], "--output-size") == 0 && i + 1 < argc) {
+            outputSizes = parseSizes(argv[++i]);
+            showUsage = outputSizes.empty();
+        } else if (std::strcmp(argv[i], "--scale-quality") == 0 && i + 1 < argc) {
+            showUsage = !parseNames(argv[++i], SCALING_QUALITY_NAMES, scalingQualities);
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--convert") == 0) {
+            conversion = true;
+        } else if (std::strcmp(argv[i], "--scrub") == 0) {
+            scrub = true;
+        } else if (std::strcmp(argv[i], "--seek") == 0) {
+            seek = true;
+        } else if (std::strcmp(argv[i], "--startup") == 0) {
+            startup = true;
+        } else if (argv[i][0] == '-') {
+            showUsage = true;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (showUsage) {
+        std::cerr << "Usage: " << argv[0] << " [--players count | --scaling] [--threads n,...] [--thread-type frame|slice|both,...]"
+                  << " [--input file|mmap|prefetch,...] [--output-size WxH,...] [--scale-quality fast|bilinear|bicubic,...]"
+                  << " [--json file|-] [--convert | --scrub | --seek | --startup] [media files...]" << std::endl;
+        return 1;
+    }
+
+    // Human-readable results go to stderr when the JSON is written to stdout
+    std::FILE* out = jsonPath == "-" ? stderr : stdout;
+
+    if (conversion) {
+        std::vector<ConvertResult> results = benchmarkConversion();
+        for (const ConvertResult& result : results) {
+            printConversion(out, result);
+        }
+
+        return jsonPath.empty() || writeJson(toConversionJson(results), jsonPath) ? 0 : 1;
+    }
+
+    if (files.empty()) {
+        files = findDefaultFiles();
+    }
+
+    if (files.empty()) {
+        std::cerr << "No media files given and none found in " << BENCHMARK_MEDIA_DIR << std::endl;
+        return 1;
+    }
+
+    if (scrub) {
+        std::vector<ScrubResult> results;
+        for (const std::string& file : files) {
+            results.push_back(benchmarkScrub(file));
+            printScrub(out, results.back());
+        }
+
+        bool failed = std::any_of(results.begin(), results.end(), [](const ScrubResult& result) { return !result.opened; });
+        return (jsonPath.empty() || writeJson(toScrubJson(results), jsonPath)) && !failed ? 0 : 1;
+    }
+
+    if (seek) {
+        std::vector<SeekResult> results;
+        for (const std::string& file : files) {
+            for (MediaPlayer::SeekMode mode : {MediaPlayer::KEYFRAME, MediaPlayer::EXACT}) {
+                results.push_back(benchmarkSeek(file, mode));
+                printSeek(out, results.back());
+            }
+        }
+
+        bool failed = std::any_of(results.begin(), results.end(), [](const SeekResult& result) { return !result.opened || result.timedOut > 0; });
+        return (jsonPath.empty() || writeJson(toSeekJson(results), jsonPath)) && !failed ? 0 : 1;
+    }
+
+    if (startup) {
+        std::vector<StartupResult> results;
+        for (const std::string& file : files) {
+            results.push_back(benchmarkStartup(file));
+            printStartup(out, results.back());
+        }
+        printStartupSummary(out, results);
+
+        bool failed = std::any_of(results.begin(), results.end(), [](const StartupResult& result) { return result.failedRuns > 0; });
+        return (jsonPath.empty() || writeJson(toStartupJson(results), jsonPath)) && !failed ? 0 : 1;
+    }
+
+    std::vector<FileResult> results;
+    double cpuStart = getCpuTime();
+    auto wallStart = Clock::now();
+
+    // Every combination of the settings, the player count varies fastest
+    std::vector<RunSettings> runs(1);
+    expandRuns(runs, inputModes, [](RunSettings& run, Demuxer::InputMode mode) { run.inputMode = mode; });
+    expandRuns(runs, outputSizes, [](RunSettings& run, const sf::Vector2u& size) { run.outputSize = size; });
+    expandRuns(runs, scalingQualities, [](RunSettings& run, VideoDecoder::ScalingQuality quality) { run.scalingQuality = quality; });
+    expandRuns(runs, threadTypes, [](RunSettings& run, DecoderThreading::Type type) { run.threading.type = type; });
+    expandRuns(runs, threadCounts, [](RunSettings& run, int count) { run.threading.threadCount = count; });
+    expandRuns(runs, playerCounts, [](RunSettings& run, int players) { run.players = players; });
+
+    // Frames at the native size are not scaled, one filter is enough for them
+    runs.erase(std::remove_if(runs.begin(), runs.end(),
+                              [&](const RunSettings& run) {
+                                  return (run.outputSize.x == 0 || run.outputSize.y == 0) && run.scalingQuality != scalingQualities.front();
+                              }),
+               runs.end());
+
+    for (const std::string& file : files) {
+        for (const RunSettings& settings : runs) {
+            results.push_back(benchmarkFile(file, settings));
+            printResult(out, results.back());
+        }
+    }
+
+    double wallTime = std::chrono::duration<double>(Clock::now() - wallStart).count();
+    double cpuTime = getCpuTime() - cpuStart;
+
+    uint64_t totalFrames = 0;
+    for (const FileResult& result : results) {
+        totalFrames += result.videoFrames;
+    }
+
+    if (results.size() > files.size()) {
+        for (const std::string& file : files) {
+            printComparison(out, results, file);
+        }
+    }
+
+    DecodeExecutor::Stats executor = DecodeExecutor::getShared().getStats();
+    std::fprintf(out, "Total: %llu frames in %.3f s: %.1f fps, CPU %.3f s, peak RSS %.1f MiB\n", static_cast<unsigned long long>(totalFrames),
+                 wallTime, wallTime > 0.0 ? totalFrames / wallTime : 0.0, cpuTime, getPeakRss() / 1024.0);
+    std::fprintf(out, "Executor: %u workers, %llu steps, %llu stolen\n", DecodeExecutor::getShared().getWorkerCount(),
+                 static_cast<unsigned long long>(executor.executed), static_cast<unsigned long long>(executor.stolen));
+
+    if (!jsonPath.empty() && !writeJson(toJson(results, wallTime, cpuTime), jsonPath)) {
+        return 1;
+    }
+
+    bool failed = std::any_of(results.begin(), results.end(), [](const FileResult& result) { return result.failedPlayers > 0; });
+    return failed ? 1 : 0;
+}
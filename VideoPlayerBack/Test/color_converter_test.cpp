@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../include/ColorConverter.hpp"
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+// Checks the color conversion kernels. The SSE4.1 and AVX2 kernels must match the scalar kernel exactly on
+// any size and stride. The scalar kernel is not bit-exact with swscale, it must stay within SWSCALE_TOLERANCE of
+// swscale set up with the same matrix and range.
+
+namespace {
+
+const char* const LAYOUT_NAMES[] = {"YUV420P", "NV12", "YUV422P"};
+const char* const MATRIX_NAMES[] = {"BT601", "BT709"};
+const char* const RANGE_NAMES[] = {"limited", "full"};
+const char* const IMPLEMENTATION_NAMES[] = {"scalar", "SSE4.1", "AVX2"};
+
+const ColorConverter::PixelLayout LAYOUTS[] = {ColorConverter::YUV420P, ColorConverter::NV12, ColorConverter::YUV422P};
+const ColorConverter::Matrix MATRICES[] = {ColorConverter::BT601, ColorConverter::BT709};
+const ColorConverter::Range RANGES[] = {ColorConverter::LIMITED, ColorConverter::FULL};
+
+// Largest allowed difference to swscale per 8-bit RGB channel, indexed by range: 3 for limited, 2 for full, the
+// same for every layout and matrix. The converter rounds 13-bit coefficients once, swscale rounds its own
+// fixed-point tables, so the two land up to 2 steps apart. Limited range adds the luma and chroma stretch to both,
+// one more step of rounding. The test frames have uniform chroma, so chroma upsampling adds nothing.
+const int SWSCALE_TOLERANCE[2] = {3, 2};
+
+// Value written around every converted row to catch writes past the row width
+constexpr uint8_t GUARD = 0xA5;
+constexpr int GUARD_BYTES = 64;
+
+// Source planes of one test frame with padded strides
+struct Frame {
+    int width;
+    int height;
+    std::vector<uint8_t> planes[3];
+
+    // Four entries like AVFrame, swscale reads all of them
+    int stride[4];
+    const uint8_t* data[4];
+};
+
+void allocate(Frame& frame, ColorConverter::PixelLayout layout, int width, int height, int padding) {
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = layout == ColorConverter::YUV422P ? height : (height + 1) / 2;
+
+    frame.width = width;
+    frame.height = height;
+    frame.stride[0] = width + padding;
+    frame.stride[1] = (layout == ColorConverter::NV12 ? chromaWidth * 2 : chromaWidth) + padding;
+    frame.stride[2] = layout == ColorConverter::NV12 ? 0 : chromaWidth + padding;
+    frame.stride[3] = 0;
+
+    frame.planes[0].assign(static_cast<size_t>(frame.stride[0]) * height, 0);
+    frame.planes[1].assign(static_cast<size_t>(frame.stride[1]) * chromaHeight, 0);
+    frame.planes[2].assign(static_cast<size_t>(frame.stride[2]) * chromaHeight, 0);
+
+    for (int i = 0; i < 3; ++i) {
+        frame.data[i] = frame.planes[i].empty() ? nullptr : frame.planes[i].data();
+    }
+    frame.data[3] = nullptr;
+}
+
+// Convert into a buffer with guard bytes after every row, returns false when a guard byte was overwritten
+bool convert(ColorConverter& converter, const Frame& frame, std::vector<uint8_t>& rgba) {
+    int dstStride = frame.width * 4 + GUARD_BYTES;
+    rgba.assign(static_cast<size_t>(dstStride) * frame.height, GUARD);
+
+    converter.convert(frame.data, frame.stride, frame.width, frame.height, rgba.data(), dstStride);
+
+    for (int y = 0; y < frame.height; ++y) {
+        const uint8_t* guard = rgba.data() + static_cast<size_t>(y) * dstStride + frame.width * 4;
+        for (int i = 0; i < GUARD_BYTES; ++i) {
+            if (guard[i] != GUARD) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Every SIMD kernel against the scalar kernel on random frames, odd sizes exercise the scalar tails
+int checkKernels() {
+    const int widths[] = {1, 2, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 640};
+    const int heights[] = {1, 2, 3, 17};
+
+    ColorConverter::Implementation best = ColorConverter::detectImplementation();
+    std::printf("Kernels: %s supported\n", IMPLEMENTATION_NAMES[best]);
+
+    std::mt19937 random(20240611);
+    int failures = 0;
+
+    for (ColorConverter::PixelLayout layout : LAYOUTS) {
+        for (ColorConverter::Matrix matrix : MATRICES) {
+            for (ColorConverter::Range range : RANGES) {
+                for (int width : widths) {
+                    for (int height : heights) {
+                        Frame frame;
+                        allocate(frame, layout, width, height, static_cast<int>(random() % 32));
+                        for (std::vector<uint8_t>& plane : frame.planes) {
+                            for (uint8_t& value : plane) {
+                                value = static_cast<uint8_t>(random());
+                            }
+                        }
+
+                        ColorConverter reference;
+                        reference.configure(layout, matrix, range);
+                        reference.setImplementation(ColorConverter::SCALAR);
+
+                        std::vector<uint8_t> expected;
+                        if (!convert(reference, frame, expected)) {
+                            std::printf("FAIL scalar %s %s %s %dx%d: wrote past the row\n", LAYOUT_NAMES[layout], MATRIX_NAMES[matrix],
+                                        RANGE_NAMES[range], width, height);
+                            ++failures;
+                        }
+
+                        for (int implementation = ColorConverter::SSE41; implementation <= best; ++implementation) {
+                            ColorConverter converter;
+                            converter.configure(layout, matrix, range);
+                            converter.setImplementation(static_cast<ColorConverter::Implementation>(implementation));
+
+                            std::vector<uint8_t> actual;
+                            bool guarded = convert(converter, frame, actual);
+
+                            if (!guarded || actual != expected) {
+                                std::printf("FAIL %s %s %s %s %dx%d: %s\n", IMPLEMENTATION_NAMES[implementation], LAYOUT_NAMES[layout],
+                                            MATRIX_NAMES[matrix], RANGE_NAMES[range], width, height,
+                                            guarded ? "differs from scalar" : "wrote past the row");
+                                ++failures;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (int implementation = best + 1; implementation <= ColorConverter::AVX2; ++implementation) {
+        std::printf("Kernels: %s not supported by this CPU, skipped\n", IMPLEMENTATION_NAMES[implementation]);
+    }
+
+    return failures;
+}
+
+// The scalar kernel against swscale on frames of uniform chroma, every luma value appears in each frame
+int checkSwscale() {
+    const AVPixelFormat formats[] = {AV_PIX_FMT_YUV420P, AV_PIX_FMT_NV12, AV_PIX_FMT_YUV422P};
+    const int width = 256;
+    const int height = 2;
+    const int chromaStep = 15;
+
+    int failures = 0;
+
+    for (ColorConverter::PixelLayout layout : LAYOUTS) {
+        for (ColorConverter::Matrix matrix : MATRICES) {
+            for (ColorConverter::Range range : RANGES) {
+                SwsContext* context = sws_getContext(width, height, formats[layout], width, height, AV_PIX_FMT_RGBA,
+                                                     SWS_BILINEAR | SWS_ACCURATE_RND | SWS_FULL_CHR_H_INT, nullptr, nullptr, nullptr);
+                if (!context) {
+                    std::printf("FAIL swscale %s: no context\n", LAYOUT_NAMES[layout]);
+                    ++failures;
+                    continue;
+                }
+
+                const int* table = sws_getCoefficients(matrix == ColorConverter::BT709 ? SWS_CS_ITU709 : SWS_CS_ITU601);
+                if (sws_setColorspaceDetails(context, table, range == ColorConverter::FULL ? 1 : 0, sws_getCoefficients(SWS_CS_DEFAULT), 1, 0,
+                                             1 << 16, 1 << 16) < 0) {
+                    std::printf("FAIL swscale %s %s %s: colorspace not supported\n", LAYOUT_NAMES[layout], MATRIX_NAMES[matrix], RANGE_NAMES[range]);
+                    sws_freeContext(context);
+                    ++failures;
+                    continue;
+                }
+
+                ColorConverter converter;
+                converter.configure(layout, matrix, range);
+                converter.setImplementation(ColorConverter::SCALAR);
+
+                Frame frame;
+                allocate(frame, layout, width, height, 0);
+                for (int y = 0; y < height; ++y) {
+                    for (int x = 0; x < width; ++x) {
+                        frame.planes[0][static_cast<size_t>(y) * frame.stride[0] + x] = static_cast<uint8_t>(x);
+                    }
+                }
+
+                std::vector<uint8_t> expected(static_cast<size_t>(width) * height * 4);
+                std::vector<uint8_t> actual;
+                int maxDifference = 0;
+
+                for (int u = 0; u <= 255; u += chromaStep) {
+                    for (int v = 0; v <= 255; v += chromaStep) {
+                        if (layout == ColorConverter::NV12) {
+                            for (size_t i = 0; i < frame.planes[1].size(); i += 2) {
+                                frame.planes[1][i] = static_cast<uint8_t>(u);
+                                frame.planes[1][i + 1] = static_cast<uint8_t>(v);
+                            }
+                        } else {
+                            std::memset(frame.planes[1].data(), u, frame.planes[1].size());
+                            std::memset(frame.planes[2].data(), v, frame.planes[2].size());
+                        }
+
+                        uint8_t* dstData[4] = {expected.data(), nullptr, nullptr, nullptr};
+                        int dstStride[4] = {width * 4, 0, 0, 0};
+                        sws_scale(context, frame.data, frame.stride, 0, height, dstData, dstStride);
+
+                        convert(converter, frame, actual);
+
+                        for (int y = 0; y < height; ++y) {
+                            const uint8_t* actualRow = actual.data() + static_cast<size_t>(y) * (width * 4 + GUARD_BYTES);
+                            const uint8_t* expectedRow = expected.data() + static_cast<size_t>(y) * width * 4;
+
+                            for (int i = 0; i < width * 4; ++i) {
+                                maxDifference = std::max(maxDifference, std::abs(actualRow[i] - expectedRow[i]));
+                            }
+                        }
+                    }
+                }
+
+                sws_freeContext(context);
+
+                int tolerance = SWSCALE_TOLERANCE[range];
+                bool passed = maxDifference <= tolerance;
+                std::printf("%s swscale %s %s %s: max difference %d, tolerance %d\n", passed ? "ok  " : "FAIL", LAYOUT_NAMES[layout],
+                            MATRIX_NAMES[matrix], RANGE_NAMES[range], maxDifference, tolerance);
+                failures += passed ? 0 : 1;
+            }
+        }
+    }
+
+    return failures;
+}
+
+}  // namespace
+
+int main() {
+    int failures = checkKernels() + checkSwscale();
+
+    if (failures > 0) {
+        std::printf("%d check%s failed\n", failures, failures == 1 ? "" : "s");
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}
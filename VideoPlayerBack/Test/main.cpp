@@ -1,11 +1,14 @@
 #include <SFML/Graphics.hpp>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "../API/MediaPlayer.hpp"
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <video_file>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <video_file> [more video files...]" << std::endl;
         return 1;
     }
 
@@ -15,8 +18,10 @@ int main(int argc, char* argv[]) {
     // Set up error handling
     player.setErrorCallback([](const MediaPlayerException& e) { std::cerr << "Error: " << e.what() << std::endl; });
 
-    // Open video file
-    if (!player.open(argv[1])) {
+    // Open video file, several files play back to back as a playlist
+    std::vector<std::string> filenames(argv + 1, argv + argc);
+    bool opened = filenames.size() > 1 ? player.setPlaylist(filenames) : player.open(filenames[0]);
+    if (!opened) {
         std::cerr << "Failed to open video file" << std::endl;
         return 1;
     }
@@ -26,14 +31,19 @@ int main(int argc, char* argv[]) {
     sf::Vector2u size = player.getVideoSize();
     std::cout << "Video size: " << size.x << "x" << size.y << std::endl;
     std::cout << "Frame rate: " << player.getFrameRate() << " fps" << std::endl;
+    std::cout << "Video decoder threads: " << player.getVideoDecoderThreadCount() << std::endl;
 
     // Create window
     sf::RenderWindow window(sf::VideoMode(size.x, size.y), "Video Player");
+    sf::Texture texture;
     sf::Sprite sprite;
 
     // Start playback
     player.play();
 
+    // Announce each playlist item as it starts
+    player.setItemChangeCallback([&filenames](int index) { std::cout << "Playing " << filenames[index] << std::endl; });
+
     // Main loop
     while (window.isOpen()) {
         sf::Event event;
@@ -46,10 +56,16 @@ int main(int argc, char* argv[]) {
                         player.togglePlayPause();
                         break;
                     case sf::Keyboard::Left:
-                        player.seek(player.getCurrentPosition() - 5.0);
+                        player.seekAsync(player.getCurrentPosition() - 5.0);
                         break;
                     case sf::Keyboard::Right:
-                        player.seek(player.getCurrentPosition() + 5.0);
+                        player.seekAsync(player.getCurrentPosition() + 5.0);
+                        break;
+                    case sf::Keyboard::N:
+                        player.playNext();
+                        break;
+                    case sf::Keyboard::P:
+                        player.playPrevious();
                         break;
                     case sf::Keyboard::Escape:
                         window.close();
@@ -64,7 +80,6 @@ int main(int argc, char* argv[]) {
         player.update();
 
         // Get current frame
-        sf::Texture texture;
         if (player.getCurrentFrame(texture)) {
             sprite.setTexture(texture, true);
         }
@@ -75,6 +90,43 @@ int main(int argc, char* argv[]) {
         window.display();
     }
 
+    // Print the startup latency breakdown
+    MediaPlayer::StartupStats startup = player.getStartupStats();
+    std::cout << "Startup: probe " << startup.probe << " s, codec open " << startup.codecOpen << " s, first packet " << startup.firstPacket
+              << " s, first frame " << startup.firstFrame << " s, first audio " << startup.firstAudio << " s" << std::endl;
+
+    // Print read stalls, only counted for custom inputs
+    MediaInput::Stats input = player.getInputStats();
+    std::cout << "Input: " << input.reads << " reads, " << input.stalls << " stalls, " << input.stallTime << " s stalled, longest "
+              << input.maxStall << " s" << std::endl;
+
+    // Print the playback counters
+    MediaPlayer::Stats stats = player.getStats();
+    std::cout << "Playback: " << stats.decodedFrames << " frames decoded, " << stats.presentedFrames << " presented, " << stats.droppedFrames
+              << " dropped, " << stats.audioUnderruns << " audio underruns, " << stats.decoderCpuTime << " s decoder CPU, " << stats.bytesRead
+              << " bytes read, " << stats.seeks << " seeks, average seek " << stats.averageSeekLatency << " s" << std::endl;
+
+    // Print the per-stage frame latencies when they are built in
+    if (LatencyHistogram::ENABLED) {
+        MediaPlayer::StageLatencies latencies = player.getStageLatencies();
+        std::pair<const char*, LatencyHistogram::Summary> stages[] = {
+            {"demux", latencies.demux},
+            {"decode send", latencies.decodeSend},
+            {"decode receive", latencies.decodeReceive},
+            {"queue wait", latencies.queueWait},
+            {"convert", latencies.convert},
+            {"upload", latencies.upload},
+            {"present", latencies.present},
+            {"update", latencies.update},
+        };
+
+        for (const auto& stage : stages) {
+            std::cout << "Latency " << stage.first << ": " << stage.second.count << " samples, p50 " << stage.second.p50 * 1e3 << " ms, p99 "
+                      << stage.second.p99 * 1e3 << " ms, p99.9 " << stage.second.p999 * 1e3 << " ms, max " << stage.second.max * 1e3 << " ms"
+                      << std::endl;
+        }
+    }
+
     // Clean up
     player.close();
 
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../include/PrefetchInput.hpp"
+
+// Reads a generated file through PrefetchInput the way FFmpeg does, through its AVIOContext, and compares every
+// byte with the file contents. The smallest window keeps the ring far smaller than the file, so sequential reads
+// wrap around it several times and seeks land inside, behind and past the prefetched bytes.
+
+namespace {
+
+// Several times the ring capacity, odd so the last read is short
+constexpr size_t FILE_SIZE = 5 * 1024 * 1024 + 12345;
+
+// Larger than the AVIOContext buffer, so seeks reach PrefetchInput instead of staying inside FFmpeg's buffer
+constexpr int64_t SEEK_STEP = 200 * 1024;
+
+constexpr int RANDOM_SEEKS = 500;
+
+// Reports a failed check, returns 1 to count it
+int check(bool passed, const char* name) {
+    std::printf("%s %s\n", passed ? "ok  " : "FAIL", name);
+    return passed ? 0 : 1;
+}
+
+// Write random bytes to a temporary file, returns its name or an empty string
+std::string createFile(std::vector<uint8_t>& contents) {
+    std::mt19937 random(20240702);
+    contents.resize(FILE_SIZE);
+    for (uint8_t& value : contents) {
+        value = static_cast<uint8_t>(random());
+    }
+
+    char name[] = "/tmp/prefetch_input_test_XXXXXX";
+    int descriptor = mkstemp(name);
+    if (descriptor < 0) {
+        return std::string();
+    }
+    ::close(descriptor);
+
+    std::ofstream file(name, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+    return file ? std::string(name) : std::string();
+}
+
+// Read size bytes at the current position and compare them with the file, a short read at the end is expected
+bool readAndCompare(AVIOContext* context, const std::vector<uint8_t>& contents, int size) {
+    int64_t position = avio_tell(context);
+    std::vector<uint8_t> buffer(static_cast<size_t>(size));
+
+    int64_t expected = std::min(static_cast<int64_t>(size), static_cast<int64_t>(contents.size()) - position);
+    int result = avio_read(context, buffer.data(), size);
+
+    if (expected <= 0) {
+        return result == AVERROR_EOF;
+    }
+
+    return result == expected && std::memcmp(buffer.data(), contents.data() + position, static_cast<size_t>(result)) == 0;
+}
+
+// The whole file front to back in uneven chunks, wrapping the ring, then the end of the file
+int checkSequential(const std::string& filename, const std::vector<uint8_t>& contents) {
+    PrefetchInput input(PrefetchInput::MIN_WINDOW_SIZE);
+    if (!input.open(filename)) {
+        return check(false, "sequential read: open");
+    }
+
+    AVIOContext* context = input.getContext();
+    const int sizes[] = {1, 4095, 70001, 333333, 1024 * 1024 + 7};
+    bool matches = true;
+
+    for (size_t i = 0; avio_tell(context) < static_cast<int64_t>(contents.size()) && matches; ++i) {
+        matches = readAndCompare(context, contents, sizes[i % 5]);
+    }
+
+    bool atEnd = avio_tell(context) == static_cast<int64_t>(contents.size());
+    uint8_t byte;
+    bool endOfFile = avio_read(context, &byte, 1) == AVERROR_EOF && avio_feof(context);
+    bool counted = input.getStats().bytesRead == contents.size();
+    input.close();
+
+    return check(matches && atEnd, "sequential read through ring wrap") + check(endOfFile, "EOF after the last byte") +
+           check(counted, "bytes counted in stats");
+}
+
+// Seeks back within the kept bytes, forward within the window, outside it, and to the end
+int checkSeeks(const std::string& filename, const std::vector<uint8_t>& contents) {
+    PrefetchInput input(PrefetchInput::MIN_WINDOW_SIZE);
+    if (!input.open(filename)) {
+        return check(false, "seek: open");
+    }
+
+    AVIOContext* context = input.getContext();
+    int failures = 0;
+
+    // Past one ring capacity, so the bytes behind the read position have already been recycled once
+    const int64_t start = 2 * 1024 * 1024 + 100;
+    bool matches = true;
+    while (avio_tell(context) < start && matches) {
+        matches = readAndCompare(context, contents, static_cast<int>(std::min<int64_t>(65536, start - avio_tell(context))));
+    }
+    failures += check(matches, "read up to the seek start");
+
+    int64_t position = avio_tell(context);
+    failures += check(avio_seek(context, position - 2 * SEEK_STEP, SEEK_SET) == position - 2 * SEEK_STEP &&
+                          readAndCompare(context, contents, 4096),
+                      "seek back inside the ring");
+
+    position = avio_tell(context);
+    failures += check(avio_seek(context, position + 2 * SEEK_STEP, SEEK_SET) == position + 2 * SEEK_STEP &&
+                          readAndCompare(context, contents, 4096),
+                      "seek forward inside the window");
+
+    failures += check(avio_seek(context, 0, SEEK_SET) == 0 && readAndCompare(context, contents, 300000), "seek back outside the ring");
+
+    int64_t nearEnd = static_cast<int64_t>(contents.size()) - 100;
+    failures += check(avio_seek(context, nearEnd, SEEK_SET) == nearEnd && readAndCompare(context, contents, 4096) &&
+                          readAndCompare(context, contents, 4096),
+                      "seek forward outside the window, short read and EOF");
+
+    failures += check(avio_size(context) == static_cast<int64_t>(contents.size()), "file size");
+
+    // Seeks of every distance, each followed by a read crossing the AVIOContext buffer
+    std::mt19937 random(20240703);
+    matches = true;
+    for (int i = 0; i < RANDOM_SEEKS && matches; ++i) {
+        int64_t current = avio_tell(context);
+        int64_t target = random() % 4 == 0 ? static_cast<int64_t>(random() % contents.size())
+                                           : std::max<int64_t>(0, current + static_cast<int64_t>(random() % (6 * SEEK_STEP)) - 3 * SEEK_STEP);
+        target = std::min(target, static_cast<int64_t>(contents.size()));
+
+        matches = avio_seek(context, target, SEEK_SET) == target && readAndCompare(context, contents, 1 + static_cast<int>(random() % 150000));
+    }
+    failures += check(matches, "random seeks");
+
+    input.close();
+    return failures;
+}
+
+}  // namespace
+
+int main() {
+    std::vector<uint8_t> contents;
+    std::string filename = createFile(contents);
+    if (filename.empty()) {
+        std::printf("FAIL could not write the test file\n");
+        return 1;
+    }
+
+    int failures = checkSequential(filename, contents) + checkSeeks(filename, contents);
+    std::remove(filename.c_str());
+
+    if (failures > 0) {
+        std::printf("%d check%s failed\n", failures, failures == 1 ? "" : "s");
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "../include/SpscRingBuffer.hpp"
+
+// Hands items from one producer thread to one consumer thread through SpscRingBuffer and through a bounded
+// std::queue guarded by a mutex and condition variables, the kind of queue it replaced between the decoders
+// and the player. Both block when full or empty, so the numbers include the waits and not only the raw push and pop.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::chrono::milliseconds WAIT_TIMEOUT(100);
+
+// Bounded blocking queue the way it was written before the ring buffer
+template <typename T>
+class MutexQueue {
+ public:
+    explicit MutexQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T&& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return items.size() < capacity; });
+        items.push(std::move(item));
+        lock.unlock();
+        notEmpty.notify_one();
+    }
+
+    void pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return !items.empty(); });
+        item = std::move(items.front());
+        items.pop();
+        lock.unlock();
+        notFull.notify_one();
+    }
+
+ private:
+    std::queue<T> items;
+    size_t capacity;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
+
+// Same size as a queued frame or audio packet reference
+struct Item {
+    uint64_t sequence;
+    double pts;
+    void* payload;
+};
+
+struct Result {
+    double seconds;
+    bool ordered;
+};
+
+Result runSpsc(size_t capacity, uint64_t count) {
+    SpscRingBuffer<Item> buffer(capacity);
+    bool ordered = true;
+
+    auto start = Clock::now();
+
+    std::thread consumer([&] {
+        Item item;
+        for (uint64_t i = 0; i < count; ++i) {
+            while (!buffer.tryPop(item)) {
+                buffer.waitForData(WAIT_TIMEOUT);
+            }
+            ordered = ordered && item.sequence == i;
+        }
+    });
+
+    for (uint64_t i = 0; i < count; ++i) {
+        Item item{i, i / 30.0, nullptr};
+        while (!buffer.waitPush(std::move(item), WAIT_TIMEOUT)) {
+            // Still full after the timeout, the consumer was descheduled
+        }
+    }
+
+    consumer.join();
+    return {std::chrono::duration<double>(Clock::now() - start).count(), ordered};
+}
+
+Result runMutex(size_t capacity, uint64_t count) {
+    MutexQueue<Item> queue(capacity);
+    bool ordered = true;
+
+    auto start = Clock::now();
+
+    std::thread consumer([&] {
+        Item item;
+        for (uint64_t i = 0; i < count; ++i) {
+            queue.pop(item);
+            ordered = ordered && item.sequence == i;
+        }
+    });
+
+    for (uint64_t i = 0; i < count; ++i) {
+        queue.push(Item{i, i / 30.0, nullptr});
+    }
+
+    consumer.join();
+    return {std::chrono::duration<double>(Clock::now() - start).count(), ordered};
+}
+
+void printResult(const char* name, size_t capacity, uint64_t count, const Result& result) {
+    std::printf("  %-12s capacity %5zu: %8.1f ns/item, %7.2f M items/s%s\n", name, capacity, result.seconds / count * 1e9,
+                count / result.seconds / 1e6, result.ordered ? "" : ", OUT OF ORDER");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    uint64_t count = 2000000;
+    int repeats = 3;
+
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+            count = std::max(1LL, std::atoll(argv[++i]));
+        } else if (std::strcmp(argv[i], "--repeats") == 0 && i + 1 < argc) {
+            repeats = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--items count] [--repeats count]" << std::endl;
+            return 1;
+        }
+    }
+
+    // The video frame queue holds 30 items and the audio packet queue 100, a small and a large queue bracket them
+    const size_t capacities[] = {8, 30, 100, 1024};
+    bool ordered = true;
+
+    std::printf("%llu items from one producer to one consumer, best of %d runs\n", static_cast<unsigned long long>(count), repeats);
+
+    for (size_t capacity : capacities) {
+        Result spsc{0.0, true};
+        Result mutex{0.0, true};
+
+        // Alternate the queues so both see the same machine state, keep the fastest run of each
+        for (int i = 0; i < repeats; ++i) {
+            Result run = runSpsc(capacity, count);
+            spsc.seconds = i == 0 ? run.seconds : std::min(spsc.seconds, run.seconds);
+            spsc.ordered = spsc.ordered && run.ordered;
+
+            run = runMutex(capacity, count);
+            mutex.seconds = i == 0 ? run.seconds : std::min(mutex.seconds, run.seconds);
+            mutex.ordered = mutex.ordered && run.ordered;
+        }
+
+        printResult("SPSC ring", capacity, count, spsc);
+        printResult("mutex queue", capacity, count, mutex);
+        std::printf("  %-12s capacity %5zu: %.2fx\n", "speedup", capacity, mutex.seconds / spsc.seconds);
+
+        ordered = ordered && spsc.ordered && mutex.ordered;
+    }
+
+    return ordered ? 0 : 1;
+}
@@ -2,10 +2,11 @@
 
 #include <SFML/Audio.hpp>
 #include <atomic>
-#include <queue>
-#include <thread>
+#include <chrono>
 
 #include "MediaDecoder.hpp"
+#include "SampleBufferPool.hpp"
+#include "SpscRingBuffer.hpp"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -13,9 +14,17 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+// Decoded audio, move-only so samples are never copied on their way to the sound stream
 struct AudioPacket {
-    std::vector<sf::Int16> samples;
-    double pts;  // Presentation timestamp
+    AudioPacket() = default;
+    AudioPacket(AudioPacket&&) = default;
+    AudioPacket& operator=(AudioPacket&&) = default;
+    AudioPacket(const AudioPacket&) = delete;
+    AudioPacket& operator=(const AudioPacket&) = delete;
+
+    std::vector<sf::Int16> samples;  // Pooled buffer, hand back with AudioDecoder::recycleSamples()
+    double pts = 0.0;                // Presentation timestamp
+    uint64_t epoch = 0;              // Seek epoch the packet was decoded in
 };
 
 class AudioDecoder : public MediaDecoder {
@@ -26,19 +35,34 @@ class AudioDecoder : public MediaDecoder {
     // Initialize the audio decoder after a file is opened
     bool initialize();
 
-    // Start the decoding thread
+    // Start decoding on the shared executor
     void start();
 
-    // Stop the decoding thread and clean up resources
+    // Stop decoding and clean up resources
     void stop();
 
     // Get next audio packet
     bool getNextPacket(AudioPacket& packet);
 
+    // Wait up to timeout for a packet to be queued, e.g. right after the decoder was started
+    bool waitForPacket(std::chrono::milliseconds timeout);
+
+    // Return the samples of a consumed packet for reuse
+    void recycleSamples(std::vector<sf::Int16>&& samples);
+
+    // Get sample buffer pool counters
+    SampleBufferPool::Stats getSamplePoolStats() const;
+
+    // Get queued audio and packets
+    QueueStats getQueueStats() const override;
+
     // Get audio properties
     unsigned int getSampleRate() const;
     unsigned int getChannelCount() const;
 
+    // Get number of threads the codec decodes with
+    int getThreadCount() const;
+
     // Check if decoder has more packets
     bool hasMorePackets() const;
 
@@ -51,21 +75,42 @@ class AudioDecoder : public MediaDecoder {
     SwrContext* swrContext;
     AVStream* audioStream;
     int audioStreamIndex;
+    std::shared_ptr<PacketQueue> inputQueue;
 
-    std::queue<AudioPacket> packetQueue;
-    std::mutex queueMutex;
-    std::condition_variable queueCondition;
+    SpscRingBuffer<AudioPacket> packetQueue;
 
-    std::thread decodingThread;
     std::atomic<bool> running;
     std::atomic<bool> paused;
 
+    // Decoding state carried from one step to the next, only touched by the running step
+    AVPacket* codecPacket;
+    AVFrame* codecFrame;
+    EpochState epochState;
+    AudioPacket pendingPacket;  // Samples the full queue refused, queued first by the next step
+    bool inputEnded;            // The end of stream packet was sent since the codec was last flushed
+
+    // Duration of the last queued packet, estimates the queued duration
+    std::atomic<double> packetDuration;
+
     // Maximum number of packets to keep in queue
     static constexpr size_t MAX_QUEUE_SIZE = 100;
 
-    // Decoding thread function
-    void decodingLoop();
+    // Packets a step sends to the codec before it makes way for other decoders
+    static constexpr int STEP_PACKETS = 16;
+
+    // Recycled sample buffers, enough for a full queue plus the packets being decoded and played
+    SampleBufferPool samplePool;
+
+    // Decoding step, run on the shared executor
+    bool decodeStep() override;
+    double getQueuedSeconds() const override;
+
+    // Move the frames the codec has ready into the queue, false if the queue is full
+    bool receiveFrames();
 
     // Convert AVFrame to audio samples
     bool convertFrameToSamples(AVFrame* frame, std::vector<sf::Int16>& samples);
+
+    // Cut the samples before a pending exact seek target, false if the whole packet lies before it
+    bool trimToSeekTarget(EpochState& state, AudioPacket& packet);
 };
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Location and keys shared by the on-disk caches of the player, so nothing is written next to the media files
+class CacheFiles {
+ public:
+    // $XDG_CACHE_HOME/VideoPlayer/<name>, falling back to ~/.cache and the temporary directory
+    static std::string getDirectory(const std::string& name);
+
+    // Get size and modification time of a media file
+    static bool getFileStamp(const std::string& filename, uint64_t& size, int64_t& modifiedTime);
+
+    // Hash of the absolute path of a media file, names its cache files
+    static uint64_t getPathHash(const std::string& filename);
+};
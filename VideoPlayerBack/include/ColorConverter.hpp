@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+
+// Converts YUV frames to packed RGBA at the source size without going through swscale.
+// Uses AVX2 or SSE4.1 kernels when the CPU supports them, with a scalar fallback.
+class ColorConverter {
+ public:
+    enum PixelLayout {
+        YUV420P,  // Planar, chroma subsampled horizontally and vertically
+        NV12,     // Luma plane plus interleaved UV plane, subsampled like YUV420P
+        YUV422P   // Planar, chroma subsampled horizontally only
+    };
+
+    enum Matrix {
+        BT601,
+        BT709
+    };
+
+    enum Range {
+        LIMITED,  // Luma 16-235, chroma 16-240
+        FULL      // 0-255
+    };
+
+    enum Implementation {
+        SCALAR,
+        SSE41,
+        AVX2
+    };
+
+    ColorConverter();
+
+    // Set the source format, coefficients are recomputed only when it changes
+    void configure(PixelLayout layout, Matrix matrix, Range range);
+
+    // Convert width x height pixels from the source planes into RGBA rows of dstStride bytes
+    void convert(const uint8_t* const src[], const int srcStride[], int width, int height, uint8_t* dst, int dstStride) const;
+
+    // Get or force the kernel set, forcing is clamped to what the CPU supports
+    Implementation getImplementation() const;
+    void setImplementation(Implementation implementation);
+
+    // Best kernel set supported by the running CPU
+    static Implementation detectImplementation();
+
+    // Fixed-point conversion coefficients with FRACTION_BITS fractional bits
+    struct Coefficients {
+        int32_t yOffset;
+        int32_t yScale;
+        int32_t vToR;
+        int32_t uToG;
+        int32_t vToG;
+        int32_t uToB;
+    };
+
+    static constexpr int FRACTION_BITS = 13;
+
+ private:
+    PixelLayout layout;
+    Matrix matrix;
+    Range range;
+    Implementation implementation;
+    Coefficients coefficients;
+
+    static Coefficients computeCoefficients(Matrix matrix, Range range);
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Process-wide pool the decoders of every player run their decoding steps on, so the number of
+// decoding threads follows the number of cores instead of the number of players. Tasks are short
+// steps that never wait for data and carry a deadline. Each worker runs the earliest deadline in its
+// own queue first and steals the earliest deadline from another worker's queue when its own is empty.
+class DecodeExecutor {
+ public:
+    using Clock = std::chrono::steady_clock;
+    using Task = std::function<void()>;
+
+    struct Stats {
+        uint64_t executed;  // Tasks run
+        uint64_t stolen;    // Tasks a worker took from another worker's queue
+    };
+
+    // 0 starts one worker per core
+    explicit DecodeExecutor(unsigned int workerCount = 0);
+    ~DecodeExecutor();
+
+    DecodeExecutor(const DecodeExecutor&) = delete;
+    DecodeExecutor& operator=(const DecodeExecutor&) = delete;
+
+    // Executor shared by all decoders, started on first use and never destroyed so decoders can still
+    // be stopped while the process exits
+    static DecodeExecutor& getShared();
+
+    // Queue a task. Submitted from a worker it goes to that worker's queue, which keeps a decoder's
+    // steps on the same core, otherwise the queues take turns.
+    void submit(Clock::time_point deadline, Task task);
+
+    unsigned int getWorkerCount() const;
+    Stats getStats() const;
+
+ private:
+    struct Entry {
+        Clock::time_point deadline;
+        uint64_t sequence;  // Keeps tasks with equal deadlines in submission order
+        Task task;
+    };
+
+    // Orders a heap so its front holds the earliest deadline
+    struct LaterDeadline {
+        bool operator()(const Entry& a, const Entry& b) const {
+            return a.deadline > b.deadline || (a.deadline == b.deadline && a.sequence > b.sequence);
+        }
+    };
+
+    // Queue of one worker, locked by its owner and by thieves
+    struct Worker {
+        std::mutex mutex;
+        std::vector<Entry> heap;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // Idle workers sleep until a task is queued
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<size_t> queuedTasks;
+    std::atomic<bool> stopping;
+
+    std::atomic<uint64_t> nextSequence;
+    std::atomic<size_t> nextWorker;
+    std::atomic<uint64_t> executedTasks;
+    std::atomic<uint64_t> stolenTasks;
+
+    // Worker thread function
+    void workerLoop(size_t index);
+
+    // Take the earliest task of a worker's queue
+    bool takeTask(Worker& worker, Entry& entry);
+
+    // Index of the worker running on this thread, -1 on other threads
+    static thread_local int currentWorker;
+};
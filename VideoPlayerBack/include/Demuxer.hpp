@@ -0,0 +1,240 @@
+#pragma once
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/avutil.h>
+}
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "ErrorHandler.hpp"
+#include "LatencyHistogram.hpp"
+#include "MediaInput.hpp"
+#include "PacketIndex.hpp"
+#include "PacketQueue.hpp"
+
+// Reads every packet of a media file once and routes it to per-stream packet queues
+class Demuxer {
+ public:
+    // How the media file is read
+    enum InputMode {
+        FILE_PROTOCOL,  // FFmpeg's file protocol, one read() per buffer
+        MEMORY_MAPPED,  // Memory mapping of a local file, see MappedFileInput
+        PREFETCH        // Background read-ahead window for slow storage, see PrefetchInput
+    };
+
+    Demuxer();
+    ~Demuxer();
+
+    Demuxer(const Demuxer&) = delete;
+    Demuxer& operator=(const Demuxer&) = delete;
+
+    // Open a media file for demuxing. Streams are probed with bounded limits, a second probe with
+    // FFmpeg's default limits only runs if that leaves a stream without its basic parameters.
+    bool open(const std::string& filename);
+
+    // Select how files are read, takes effect on the next open(). Falls back to the file protocol
+    // if the file cannot be read that way.
+    void setInputMode(InputMode mode);
+    InputMode getInputMode() const;
+
+    // Bytes the PREFETCH input keeps ahead of the read position, takes effect on the next open()
+    void setPrefetchWindow(size_t bytes);
+    size_t getPrefetchWindow() const;
+
+    // Read counters of the custom input, all zero for the file protocol.
+    // Call from the thread that opens and closes the demuxer.
+    MediaInput::Stats getInputStats() const;
+
+    // Packets the demuxing thread has read since open() and the time it spent reading them
+    struct ReadStats {
+        uint64_t packets;
+        double readTime;  // Seconds
+        uint64_t bytes;   // Payload bytes of the packets
+    };
+    ReadStats getReadStats() const;
+
+    // Distribution of single av_read_frame() calls since open(), empty unless built with STAGE_HISTOGRAMS
+    LatencyHistogram::Summary getReadLatency() const;
+
+    // Stop demuxing, close the media file and release resources
+    void close();
+
+    // Start the demuxing thread
+    void start();
+
+    // Stop the demuxing thread
+    void stop();
+
+    // Seek to a specific position in seconds. Every seek starts a new epoch, queued packets are flushed
+    // and decoders discard whatever they still hold from earlier epochs. An exact seek also makes the
+    // decoders skip output before the position.
+    bool seek(double seconds, bool exact = false);
+
+    // Queue a seek for the demuxing thread and return immediately. A request that has not been
+    // performed yet is replaced by the next one, so only the latest position is ever read.
+    void requestSeek(double seconds, bool exact = false);
+
+    // Check whether a requested seek has not been performed yet
+    bool isSeekPending() const;
+
+    // Current seek epoch, packets are stamped with the epoch they were read in
+    uint64_t getSeekEpoch() const;
+
+    // Exact seek target of an epoch, negative if the epoch is outdated or was not an exact seek
+    double getSeekTarget(uint64_t epoch) const;
+
+    // While scrubbing, only the video keyframe at each requested position is read and delivered
+    void setScrubbing(bool enabled);
+    bool isScrubbing() const;
+
+    // Number of requested seeks replaced by a newer request before being performed
+    size_t getCoalescedSeekCount() const;
+
+    // Loop back to the beginning at the end of the file, enabled by default. Without looping each stream
+    // queue receives an empty packet at the end, which makes its decoder drain the codec, and reading
+    // resumes only after a seek.
+    void setLooping(bool enabled);
+    bool isLooping() const;
+
+    // Check whether a file that does not loop has been read to its end, or reading failed for good.
+    // Either way every decoder has received the end of stream packet.
+    bool isEndOfFile() const;
+
+    // Get the total duration of the media in seconds
+    double getDuration() const;
+
+    // Check if the media is currently open
+    bool isOpen() const;
+
+    // Find a stream of the specified type
+    int findStream(AVMediaType type) const;
+
+    // Get stream by index
+    AVStream* getStream(int streamIndex) const;
+
+    // Get the packet queue for a stream, creating it on first use.
+    // Must be called before start(). The queue is shared, so it stays valid for a decoder that is
+    // still attached when the demuxer is closed, it just receives no more packets.
+    std::shared_ptr<PacketQueue> openStream(int streamIndex);
+
+    // Load or build the keyframe index in the background on open, enabled by default
+    void setIndexing(bool enabled);
+
+    // Get the keyframe index, nullptr until it is loaded or built
+    std::shared_ptr<const PacketIndex> getIndex() const;
+
+    // Time the first packet was routed to a stream queue after open, false until then
+    bool getFirstPacketTime(std::chrono::steady_clock::time_point& time) const;
+
+    // Errors of opening, reading and seeking, taken out by the owner of the demuxer
+    ErrorChannel& getErrorChannel();
+
+ private:
+    AVFormatContext* formatContext;
+    std::unique_ptr<MediaInput> input;
+    InputMode inputMode;
+    size_t prefetchWindow;
+    bool opened;
+    mutable std::mutex mutex;
+    std::string filename;
+    ErrorChannel errors;
+
+    std::map<int, std::shared_ptr<PacketQueue>> streamQueues;
+
+    std::thread demuxingThread;
+    std::atomic<bool> running;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCondition;
+
+    struct SeekRequest {
+        double seconds;
+        bool exact;
+    };
+
+    // Latest requested seek and the seek epoch state, guarded by seekMutex
+    SeekRequest pendingRequest;
+    uint64_t requestedSeeks;
+    uint64_t performedSeeks;
+    double seekTarget;
+    mutable std::mutex seekMutex;
+
+    std::atomic<bool> seekRequested;
+    std::atomic<uint64_t> seekEpoch;
+    std::atomic<bool> scrubbing;
+    std::atomic<size_t> coalescedSeeks;
+
+    std::atomic<bool> looping;
+    std::atomic<bool> endOfFile;  // Changed with mutex held
+
+    // Keyframe index, used for seeking once available
+    std::shared_ptr<const PacketIndex> packetIndex;
+    std::thread indexingThread;
+    std::atomic<bool> indexingAborted;
+    bool indexingEnabled;
+
+    // Startup timing, firstPacketTime is written once before firstPacketRead is set
+    std::chrono::steady_clock::time_point firstPacketTime;
+    std::atomic<bool> firstPacketRead;
+
+    // Read counters
+    std::atomic<uint64_t> packetsRead;
+    std::atomic<uint64_t> readNanoseconds;
+    std::atomic<uint64_t> bytesRead;
+    LatencyHistogram readLatency;
+
+    // Bounded stream probing, enough for the stream parameters of typical files
+    static constexpr int64_t PROBE_SIZE = 1024 * 1024;  // Bytes
+    static constexpr int64_t ANALYZE_DURATION = 500000;  // Microseconds
+
+    // FFmpeg's default probe size, used when the bounded probe is not enough
+    static constexpr int64_t DEFAULT_PROBE_SIZE = 5000000;
+
+    // Stop reading once this many bytes are queued across all streams
+    static constexpr size_t MAX_QUEUE_BYTES = 16 * 1024 * 1024;
+
+    // Stop reading once every stream has at least this many packets queued
+    static constexpr size_t MIN_QUEUE_PACKETS = 25;
+
+    // Demuxing thread function
+    void demuxingLoop();
+
+    // Indexing thread function, loads the cached index or builds and saves the index reading through its own input
+    void indexingLoop(std::string filename, std::unique_ptr<MediaInput> indexInput);
+
+    // Custom input for the selected mode, nullptr for the file protocol
+    std::unique_ptr<MediaInput> createInput() const;
+
+    // Abort and join the indexing thread
+    void stopIndexing();
+
+    // Seek to the indexed keyframe before seconds, by byte position in formats that resync on any byte and by
+    // its timestamp otherwise. False if the index cannot be used.
+    bool seekWithIndex(double seconds);
+
+    // Check whether probing found the parameters needed to open every audio and video codec
+    bool streamsDescribed() const;
+
+    // Check whether the queues hold enough data to pause reading
+    bool queuesFull() const;
+
+    // Check whether a packet is a keyframe of a video stream
+    bool isVideoKeyframe(const AVPacket* packet) const;
+
+    // Seek with mutex held
+    bool seekLocked(double seconds, bool exact);
+
+    // Perform the latest requested seek, false if none is pending
+    bool performRequestedSeek();
+
+    // Drop all queued packets, refusing packets of epochs before epoch
+    void flushQueues(uint64_t epoch);
+};
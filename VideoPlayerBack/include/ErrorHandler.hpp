@@ -1,7 +1,10 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
-#include <functional>
+#include <memory>
 #include <string>
 
 // Custom exception class for media player errors
@@ -27,33 +30,62 @@ class MediaPlayerException : public std::exception {
     std::string message;
 };
 
-class ErrorHandler {
+// Errors of one component, reported from any of its threads and delivered on the thread that owns it.
+// A bounded lock-free queue: reporting never blocks or takes a lock, errors beyond the capacity are
+// counted and dropped. Only one thread may take errors out.
+class ErrorChannel {
  public:
-    // Singleton pattern
-    static ErrorHandler& getInstance();
+    explicit ErrorChannel(size_t capacity = DEFAULT_CAPACITY);
 
-    // Set error callback
-    void setErrorCallback(std::function<void(const MediaPlayerException&)> callback);
+    ErrorChannel(const ErrorChannel&) = delete;
+    ErrorChannel& operator=(const ErrorChannel&) = delete;
 
-    // Handle error and call callback if set
-    void handleError(MediaPlayerException::ErrorCode code, const std::string& message);
+    // Any thread: queue an error, false if the channel is full. The message is moved into its slot, a built
+    // message is never copied.
+    bool report(MediaPlayerException::ErrorCode code, std::string message);
 
-    // Convert FFmpeg error code to string
-    static std::string ffmpegErrorToString(int errorCode);
+    // Consumer: take the oldest error, false if there is none
+    bool tryPop(MediaPlayerException::ErrorCode& code, std::string& message);
+
+    // Consumer: move every queued error to another channel
+    void forwardTo(ErrorChannel& target);
+
+    // Errors dropped because the channel was full
+    uint64_t getDroppedCount() const;
+
+    static constexpr size_t DEFAULT_CAPACITY = 64;
 
  private:
-    ErrorHandler() = default;
-    ~ErrorHandler() = default;
-    ErrorHandler(const ErrorHandler&) = delete;
-    ErrorHandler& operator=(const ErrorHandler&) = delete;
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // A slot is free for the producer whose position equals its sequence, and holds an error for the
+    // consumer once the sequence is one past that position
+    struct Slot {
+        std::atomic<size_t> sequence;
+        MediaPlayerException::ErrorCode code;
+        std::string message;
+    };
 
-    std::function<void(const MediaPlayerException&)> errorCallback;
+    std::unique_ptr<Slot[]> slots;
+    const size_t mask;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueuePosition;  // Claimed by producers
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeuePosition;  // Written by the consumer
+    std::atomic<uint64_t> dropped;
+
+    static size_t getSlotCount(size_t capacity);
+};
+
+class ErrorHandler {
+ public:
+    // Convert FFmpeg error code to string
+    static std::string ffmpegErrorToString(int errorCode);
 };
 
-// Macro for error checking with FFmpeg functions
-#define CHECK_FFMPEG_ERROR(result, operation)                                                                                                      \
-    if (result < 0) {                                                                                                                              \
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, std::string("FFmpeg error: ") + operation +                   \
-                                                                                         " failed: " + ErrorHandler::ffmpegErrorToString(result)); \
-        return false;                                                                                                                              \
+// Macro for error checking with FFmpeg functions, reports to the error channel of the component it is used in
+#define CHECK_FFMPEG_ERROR(result, operation)                                                                                                        \
+    if (result < 0) {                                                                                                                                \
+        errors.report(MediaPlayerException::DECODER_ERROR,                                                                                           \
+                      std::string("FFmpeg error: ") + operation + " failed: " + ErrorHandler::ffmpegErrorToString(result));                          \
+        return false;                                                                                                                                \
     }
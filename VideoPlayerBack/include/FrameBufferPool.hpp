@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Recycles equally sized, page-aligned pixel buffers so frame conversion does not hit the allocator
+class FrameBufferPool {
+ public:
+    struct Stats {
+        size_t hits;            // Acquisitions served from a recycled buffer
+        size_t misses;          // Acquisitions that had to allocate
+        size_t allocatedBytes;  // Bytes currently owned by the pool and its handed out buffers
+    };
+
+    // Handle to a pooled buffer, returns it to the pool when destroyed
+    class Buffer {
+     public:
+        Buffer();
+        ~Buffer();
+
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
+        uint8_t* data() const { return bufferData; }
+        size_t size() const { return bufferSize; }
+        explicit operator bool() const { return bufferData != nullptr; }
+
+     private:
+        friend class FrameBufferPool;
+
+        Buffer(FrameBufferPool* pool, uint8_t* data, size_t size, bool mapped);
+
+        void release();
+
+        FrameBufferPool* pool;
+        uint8_t* bufferData;
+        size_t bufferSize;
+        bool mapped;
+    };
+
+    explicit FrameBufferPool(size_t maxFreeBuffers = 4);
+    ~FrameBufferPool();
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    // Set the size of the buffers handed out, dropping recycled buffers of another size
+    void setBufferSize(size_t size);
+    size_t getBufferSize() const;
+
+    // Allocate count buffers up front so the first frames are hits
+    void preallocate(size_t count);
+
+    // Back buffers with huge pages where the system allows it
+    void setHugePages(bool enabled);
+
+    // Get a buffer of the configured size, empty if allocation failed
+    Buffer acquire();
+
+    // Get pool counters
+    Stats getStats() const;
+
+ private:
+    struct Block {
+        uint8_t* data;
+        bool mapped;
+    };
+
+    // Return a buffer handed out by acquire()
+    void recycle(uint8_t* data, size_t size, bool mapped);
+
+    Block allocate(size_t size);
+    void deallocate(const Block& block, size_t size);
+
+    std::vector<Block> freeBlocks;
+    size_t maxFreeBuffers;
+    size_t bufferSize;
+    bool hugePages;
+    mutable std::mutex poolMutex;
+
+    std::atomic<size_t> hits;
+    std::atomic<size_t> misses;
+    std::atomic<size_t> allocatedBytes;
+
+    // Buffers are page aligned, huge page backed buffers are rounded to whole huge pages
+    static constexpr size_t BUFFER_ALIGNMENT = 4096;
+    static constexpr size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free latency histogram with logarithmic buckets split into 32 linear sub-buckets, so every
+// recorded latency keeps about 3% precision from nanoseconds up to minutes. Any thread may record
+// while another reads a summary, every counter is a relaxed atomic.
+//
+// Built only with STAGE_HISTOGRAMS defined. Otherwise the histogram is empty, now() does not read
+// the clock and record() does nothing, so the timing at the call sites compiles away.
+class LatencyHistogram {
+ public:
+    using Clock = std::chrono::steady_clock;
+
+    // Latencies in seconds, all zero while nothing was recorded
+    struct Summary {
+        uint64_t count;
+        double p50;
+        double p99;
+        double p999;
+        double max;
+    };
+
+#ifdef STAGE_HISTOGRAMS
+    static constexpr bool ENABLED = true;
+
+    LatencyHistogram();
+
+    // Start of a measured stage
+    static Clock::time_point now() { return Clock::now(); }
+
+    // Record the time from start until now
+    void record(Clock::time_point start) { recordNanoseconds(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()); }
+
+    // Record a latency measured elsewhere
+    void recordNanoseconds(int64_t nanoseconds) {
+        uint64_t value = nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds) : 0;
+
+        buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t currentMax = maxValue.load(std::memory_order_relaxed);
+        while (value > currentMax && !maxValue.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Percentiles of everything recorded since the last reset. Reports the upper bound of the bucket holding
+    // each percentile, latencies recorded while the summary is taken may or may not be included.
+    Summary getSummary() const;
+
+    // Forget everything recorded, for a new file
+    void reset();
+
+ private:
+    static constexpr int SUB_BUCKET_BITS = 5;
+    static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40;  // Latencies from 2^41 ns, about 37 minutes, share the last bucket
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets;
+    std::atomic<uint64_t> maxValue;
+
+    // Bucket of a latency in nanoseconds. Below 32 ns each value has its own bucket, above that the position
+    // of the highest set bit picks the group and the 5 bits below it pick the sub-bucket.
+    static size_t getBucket(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<size_t>(value);
+        }
+
+        int exponent = 63 - __builtin_clzll(value);
+        if (exponent > MAX_EXPONENT) {
+            return BUCKET_COUNT - 1;
+        }
+
+        uint64_t subBucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + subBucket);
+    }
+
+    // Largest latency in nanoseconds that falls into a bucket
+    static uint64_t getBucketLimit(size_t bucket);
+#else
+    static constexpr bool ENABLED = false;
+
+    static Clock::time_point now() { return Clock::time_point(); }
+    void record(Clock::time_point) {}
+    void recordNanoseconds(int64_t) {}
+    Summary getSummary() const { return Summary{0, 0.0, 0.0, 0.0, 0.0}; }
+    void reset() {}
+#endif
+};
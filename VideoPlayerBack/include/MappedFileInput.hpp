@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "MediaInput.hpp"
+
+// Reads a local file through a read-only memory mapping, FFmpeg's buffer is filled by a copy from
+// the mapping instead of a read() call. The kernel is advised of sequential access during playback
+// and of random access after a seek, until reading has continued in order for a while.
+class MappedFileInput : public MediaInput {
+ public:
+    MappedFileInput();
+    ~MappedFileInput() override;
+
+ protected:
+    bool openFile(const std::string& filename) override;
+    void closeFile() override;
+    int read(uint8_t* buffer, int size) override;
+    int64_t seek(int64_t offset, int whence) override;
+
+ private:
+    const uint8_t* data;
+    size_t fileSize;
+    size_t position;
+
+    // Current access hint and where in-order reading started
+    bool sequential;
+    size_t sequentialStart;
+
+    // Bytes read in order after a seek before the hint returns to sequential
+    static constexpr size_t SEQUENTIAL_THRESHOLD = 4 * 1024 * 1024;
+
+    // Forward jumps up to this far, e.g. skipping an unwanted packet, do not count as a seek
+    static constexpr size_t SHORT_SEEK_DISTANCE = 256 * 1024;
+
+    // Apply an access hint to the whole mapping
+    void advise(bool sequential);
+};
@@ -8,26 +8,48 @@ extern "C" {
 #include <libavutil/time.h>
 }
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
 
+#include "DecodeExecutor.hpp"
+#include "Demuxer.hpp"
 #include "ErrorHandler.hpp"
 
+// Codec threading configuration applied when a decoder is initialized
+struct DecoderThreading {
+    enum Type {
+        FRAME,
+        SLICE,
+        FRAME_AND_SLICE
+    };
+
+    // Steps of every decoder already spread over all executor workers, so one codec thread each keeps the cores
+    // from being oversubscribed however many players decode. 0 lets FFmpeg pick one thread per core.
+    int threadCount = 1;
+    Type type = FRAME_AND_SLICE;
+};
+
 class MediaDecoder {
  public:
     MediaDecoder();
     virtual ~MediaDecoder();
 
-    // Open a media file for decoding
+    // Open a media file for decoding with a private demuxer
     bool open(const std::string& filename);
 
-    // Close the media file and release resources
+    // Attach to an already opened demuxer shared with other decoders
+    bool open(std::shared_ptr<Demuxer> demuxer);
+
+    // Detach from the demuxer and release resources
     void close();
 
-    // Seek to a specific position in seconds
-    bool seek(double seconds);
+    // Seek to a specific position in seconds. A keyframe seek resumes at the keyframe before the position,
+    // an exact seek also skips everything decoded before it.
+    bool seek(double seconds, bool exact = false);
 
     // Get the total duration of the media in seconds
     double getDuration() const;
@@ -35,12 +57,116 @@ class MediaDecoder {
     // Check if the media is currently open
     bool isOpen() const;
 
+    // Check whether everything up to the end of a file that does not loop has been decoded and queued.
+    // Cleared by the next seek.
+    bool isEndOfStream() const;
+
+    // Set codec threading, takes effect on the next initialize()
+    void setThreading(const DecoderThreading& threading);
+    DecoderThreading getThreading() const;
+
+    // Errors of opening and decoding, taken out by the owner of the decoder
+    ErrorChannel& getErrorChannel();
+
+    // Decoding steps run since open(), the time they kept an executor worker busy and what they decoded
+    struct StepStats {
+        uint64_t steps;
+        double busyTime;   // Seconds
+        double cpuTime;    // CPU seconds of the steps, without the codec's own frame and slice threads
+        uint64_t decoded;  // Frames or audio packets decoded for the consumer
+    };
+    StepStats getStepStats() const;
+
+    // Output waiting for the consumer and input waiting to be decoded. Call from the thread that opens and
+    // closes the decoder.
+    struct QueueStats {
+        size_t decoded;      // Frames or audio packets
+        size_t packets;      // Demuxed packets
+        size_t packetBytes;  // Bytes of the demuxed packets
+    };
+    virtual QueueStats getQueueStats() const = 0;
+
  protected:
     // Find a stream of the specified type
     int findStream(AVMediaType type) const;
 
-    AVFormatContext* formatContext;
+    // Configure codec threads before the codec is opened
+    void applyThreading(AVCodecContext* context, const AVCodec* codec) const;
+
+    // Number of threads an opened codec actually decodes with
+    static int activeThreadCount(const AVCodecContext* context);
+
+    // Decode for a bounded time on the shared executor, true if the step stopped only because its budget was
+    // used up, false once it has to wait for input, space in its output queue or resume
+    virtual bool decodeStep() = 0;
+
+    // Seconds of decoded output queued, the next step is due before they have played out
+    virtual double getQueuedSeconds() const = 0;
+
+    // Make sure a decoding step runs soon, from any thread. Called when input arrives, output is taken or
+    // decoding resumes.
+    void requestDecode();
+
+    // Let decoding steps run, and stop them waiting until none is queued or running
+    void startSteps();
+    void stopSteps();
+
+    // Seek epoch the decoding steps are currently producing output for
+    struct EpochState {
+        uint64_t epoch = 0;
+        double seekTarget = -1.0;  // Output ending before this is skipped, negative once reached
+    };
+
+    // Called by the decoding step for every packet. Flushes the codec when the packet starts a new epoch
+    // and loads its seek target, false if a later seek already made the packet stale.
+    bool enterEpoch(EpochState& state, uint64_t packetEpoch, AVCodecContext* context);
+
+    // Check whether output of an epoch was superseded by a later seek
+    bool isStaleEpoch(uint64_t epoch) const;
+
+    // True if output ending at endPts lies before the seek target and must be skipped, the first output reaching it clears it
+    static bool skipBeforeSeekTarget(EpochState& state, double endPts);
+
+    // Check whether a packet is the empty packet the demuxer queues at the end of a file that does not loop
+    static bool isEndOfStreamPacket(const AVPacket* packet);
+
+    // Called by the decoding step once the codec is drained after the end of stream packet
+    void setEndOfStream(const EpochState& state);
+
+    std::shared_ptr<Demuxer> demuxer;
     bool opened;
+    ErrorChannel errors;
+
+    // Set by setEndOfStream(), only valid while its epoch is current
+    std::atomic<bool> endOfStream;
+    std::atomic<uint64_t> endOfStreamEpoch;
+
+    // Counted by the decoding step for every frame or audio packet it hands to the consumer
+    std::atomic<uint64_t> decodedCount;
+
     std::mutex mutex;
     std::string filename;
+    DecoderThreading threading;
+
+ private:
+    // Step scheduling state, guarded by stepMutex. At most one step of a decoder is queued or running.
+    bool stepsEnabled;
+    bool stepQueued;
+    bool wakeRequested;  // Work arrived since the running step started
+    std::mutex stepMutex;
+    std::condition_variable stepCondition;
+
+    // Step counters
+    std::atomic<uint64_t> stepCount;
+    std::atomic<uint64_t> stepNanoseconds;
+    std::atomic<uint64_t> stepCpuNanoseconds;
+
+    // Queue a step due before the queued output runs out, with stepMutex held
+    void submitStep();
+
+    // Executor task, runs steps until the decoder has to wait
+    void runStep();
+
+    // CPU time the calling thread has used, 0 where the platform cannot tell
+    static uint64_t getThreadCpuNanoseconds();
 };
@@ -0,0 +1,73 @@
+#pragma once
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Custom I/O for a format context in place of FFmpeg's file protocol.
+// Subclasses provide reading and seeking, the base class wraps them in an AVIOContext.
+class MediaInput {
+ public:
+    // Counters of the reads FFmpeg issued, a stall is a read that had to wait for storage
+    struct Stats {
+        uint64_t reads;
+        uint64_t bytesRead;
+        uint64_t stalls;
+        double stallTime;  // Total seconds spent in stalled reads
+        double maxStall;   // Longest stalled read in seconds
+    };
+
+    virtual ~MediaInput();
+
+    MediaInput(const MediaInput&) = delete;
+    MediaInput& operator=(const MediaInput&) = delete;
+
+    // Open a file and create the I/O context
+    bool open(const std::string& filename);
+
+    // Release the I/O context and close the file, the format context using it must be closed first
+    void close();
+
+    // Context to set as AVFormatContext::pb before avformat_open_input(), nullptr until opened
+    AVIOContext* getContext() const;
+
+    // Get read counters since open(), safe to call while another thread reads
+    Stats getStats() const;
+
+ protected:
+    MediaInput();
+
+    // Open or close the underlying file
+    virtual bool openFile(const std::string& filename) = 0;
+    virtual void closeFile() = 0;
+
+    // Read up to size bytes, returns the number of bytes read, AVERROR_EOF at the end or another AVERROR
+    virtual int read(uint8_t* buffer, int size) = 0;
+
+    // Seek like lseek(), AVSEEK_SIZE in whence asks for the file size instead
+    virtual int64_t seek(int64_t offset, int whence) = 0;
+
+ private:
+    AVIOContext* context;
+
+    // Size of the buffer FFmpeg reads through
+    static constexpr int BUFFER_SIZE = 64 * 1024;
+
+    // Reads taking longer than this count as stalls
+    static constexpr int64_t STALL_THRESHOLD_NS = 1000000;
+
+    // Written by the reading thread only, relaxed
+    std::atomic<uint64_t> reads;
+    std::atomic<uint64_t> bytesRead;
+    std::atomic<uint64_t> stalls;
+    std::atomic<int64_t> stallTimeNs;
+    std::atomic<int64_t> maxStallNs;
+
+    // AVIOContext callbacks, opaque is the MediaInput
+    static int readPacket(void* opaque, uint8_t* buffer, int size);
+    static int64_t seekPacket(void* opaque, int64_t offset, int whence);
+};
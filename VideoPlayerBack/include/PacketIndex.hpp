@@ -0,0 +1,65 @@
+#pragma once
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MediaInput.hpp"
+
+// Keyframe index of a media file: pts, byte position and frame number of every keyframe per stream.
+// Built once by reading all packets and cached in the user's cache directory, never next to the media file.
+class PacketIndex {
+ public:
+    struct Entry {
+        int64_t pts;          // Keyframe timestamp in the stream time base
+        int64_t position;     // Byte position of the packet in the file, -1 if unknown
+        int64_t frameNumber;  // Number of packets of the stream before this one
+    };
+
+    struct StreamEntries {
+        int streamIndex;
+        AVRational timeBase;
+        double frameDuration;  // Seconds per frame, used to interpolate between keyframes
+        int64_t frameCount;
+        std::vector<Entry> keyframes;  // Sorted by pts
+    };
+
+    // Read every packet of filename and record its keyframes, gives up when abort becomes true.
+    // Reads through input if given, it must have been opened on the same file.
+    bool build(const std::string& filename, const std::atomic<bool>& abort, MediaInput* input = nullptr);
+
+    // Read or write the cached index, it is only valid for the media file path, size and modification time it was built for
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+
+    // Cache file of a media file in $XDG_CACHE_HOME/VideoPlayer/index, named by its path hash, size and modification time
+    static std::string getCachePath(const std::string& filename);
+
+    // Check whether a stream has at least one keyframe
+    bool hasStream(int streamIndex) const;
+
+    // Last keyframe at or before seconds, nullptr if there is none
+    const Entry* findKeyframe(int streamIndex, double seconds) const;
+
+    // Convert between frame numbers and timestamps in seconds
+    int64_t getFrameNumber(int streamIndex, double seconds) const;
+    double getFrameTimestamp(int streamIndex, int64_t frameNumber) const;
+
+ private:
+    std::vector<StreamEntries> streams;
+
+    const StreamEntries* findStream(int streamIndex) const;
+
+    // Cache file name of a media file with a known size and modification time
+    static std::string getCacheName(uint64_t pathHash, uint64_t fileSize, int64_t modifiedTime);
+
+    // Cache file layout: FileHeader, then per stream a StreamHeader followed by its entries
+    static constexpr char MAGIC[4] = {'V', 'P', 'I', 'X'};
+    static constexpr uint32_t VERSION = 2;
+    static constexpr const char* EXTENSION = ".vpidx";
+};
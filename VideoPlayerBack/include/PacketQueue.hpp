@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// Thread-safe FIFO of demuxed packets for a single stream.
+// Every packet carries the seek epoch it was read in, packets of an epoch older than the last flush are refused.
+// Queued AVPackets and queue storage are recycled, so a steady stream of packets allocates nothing.
+class PacketQueue {
+ public:
+    struct PoolStats {
+        size_t hits;    // Pushes served from a recycled AVPacket
+        size_t misses;  // Pushes that allocated an AVPacket
+    };
+
+    PacketQueue();
+    ~PacketQueue();
+
+    PacketQueue(const PacketQueue&) = delete;
+    PacketQueue& operator=(const PacketQueue&) = delete;
+
+    // Move the packet's reference into the queue, false and left untouched if epoch is outdated
+    bool push(AVPacket* packet, uint64_t epoch);
+
+    // Move the oldest queued packet into packet, waiting up to timeout for one to arrive
+    bool pop(AVPacket* packet, uint64_t& epoch, std::chrono::milliseconds timeout);
+
+    // Drop all queued packets
+    void flush();
+
+    // Drop all queued packets and refuse packets of epochs before epoch from now on
+    void flush(uint64_t epoch);
+
+    // Get queue state
+    size_t size() const;
+    size_t byteSize() const;
+    PoolStats getPoolStats() const;
+
+    // Set callback invoked after a packet has been consumed
+    void setPopCallback(std::function<void()> callback);
+
+    // Set callback invoked when a packet has been queued, called with the queue locked so it never runs
+    // after it has been replaced
+    void setPushCallback(std::function<void()> callback);
+
+ private:
+    struct QueuedPacket {
+        AVPacket* packet;
+        uint64_t epoch;
+    };
+
+    // Get an empty AVPacket, recycled when one is free, with the queue locked
+    AVPacket* acquirePacketLocked();
+
+    // Unreference packet and keep it for reuse, with the queue locked
+    void releasePacketLocked(AVPacket* packet);
+
+    // Queued packets in a ring that only ever grows, oldest at head
+    std::vector<QueuedPacket> ring;
+    size_t head;
+    size_t count;
+
+    // Emptied AVPackets waiting for reuse
+    std::vector<AVPacket*> freePackets;
+    size_t hits;
+    size_t misses;
+
+    size_t bytes;
+    uint64_t currentEpoch;
+    mutable std::mutex queueMutex;
+    std::condition_variable queueCondition;
+
+    std::function<void()> popCallback;
+    std::function<void()> pushCallback;
+
+    static constexpr size_t INITIAL_CAPACITY = 64;
+    static constexpr size_t MAX_FREE_PACKETS = 1024;
+};
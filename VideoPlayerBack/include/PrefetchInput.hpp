@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MediaInput.hpp"
+
+// Reads a file through a background thread that keeps a window of bytes ahead of the read position,
+// so slow storage stalls the prefetch thread instead of the demuxer. A seek outside the window
+// discards it and prefetching restarts at the new position.
+class PrefetchInput : public MediaInput {
+ public:
+    explicit PrefetchInput(size_t windowSize = DEFAULT_WINDOW_SIZE);
+    ~PrefetchInput() override;
+
+    // Bytes kept ahead of the read position by default and the accepted range
+    static constexpr size_t DEFAULT_WINDOW_SIZE = 16 * 1024 * 1024;
+    static constexpr size_t MIN_WINDOW_SIZE = 1024 * 1024;
+    static constexpr size_t MAX_WINDOW_SIZE = 256 * 1024 * 1024;
+
+ protected:
+    bool openFile(const std::string& filename) override;
+    void closeFile() override;
+    int read(uint8_t* buffer, int size) override;
+    int64_t seek(int64_t offset, int whence) override;
+
+ private:
+    int descriptor;
+    int64_t fileSize;
+    const size_t capacity;  // Window size plus KEEP_BEHIND
+
+    // Ring buffer holding the file bytes [windowStart, windowStart + windowLength), guarded by mutex
+    std::vector<uint8_t> window;
+    size_t windowHead;  // Ring offset of windowStart
+    size_t windowLength;
+    int64_t windowStart;
+    int64_t position;
+    uint64_t generation;  // Bumped when the window is discarded, a read in flight for an older one is dropped
+    bool endOfFile;
+    int readError;
+
+    std::thread prefetchThread;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable dataCondition;
+    std::condition_variable spaceCondition;
+
+    // Largest single read issued by the prefetch thread
+    static constexpr size_t CHUNK_SIZE = 1024 * 1024;
+
+    // Seeks this far back stay within the window, FFmpeg often steps back a little while probing
+    static constexpr size_t KEEP_BEHIND = 512 * 1024;
+
+    // Prefetch thread function
+    void prefetchLoop();
+
+    // Start the window at offset, with mutex held
+    void resetWindow(int64_t offset);
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <SFML/Audio.hpp>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Recycles audio sample vectors so their capacity is reused instead of reallocated.
+// Lock-free, the audio device thread returning buffers never waits for the decoding thread.
+class SampleBufferPool {
+ public:
+    struct Stats {
+        size_t hits;    // Acquisitions served from a recycled buffer
+        size_t misses;  // Acquisitions that returned a fresh buffer
+    };
+
+    explicit SampleBufferPool(size_t maxFreeBuffers);
+
+    SampleBufferPool(const SampleBufferPool&) = delete;
+    SampleBufferPool& operator=(const SampleBufferPool&) = delete;
+
+    // Any thread: get an empty buffer, keeping the capacity of a recycled one when available
+    std::vector<sf::Int16> acquire();
+
+    // Any thread: return a buffer to the pool, dropped if every slot is taken
+    void release(std::vector<sf::Int16>&& samples);
+
+    // Drop all recycled buffers
+    void clear();
+
+    // Get pool counters
+    Stats getStats() const;
+
+ private:
+    // A thread claims a slot by moving it to BUSY, only the claiming thread touches its buffer
+    enum SlotState { EMPTY, BUSY, FULL };
+
+    struct Slot {
+        std::atomic<int> state;
+        std::vector<sf::Int16> samples;
+    };
+
+    // Claim a slot in state from and return it, nullptr if there is none
+    Slot* claim(SlotState from);
+
+    std::unique_ptr<Slot[]> slots;
+    size_t slotCount;
+
+    std::atomic<size_t> hits;
+    std::atomic<size_t> misses;
+};
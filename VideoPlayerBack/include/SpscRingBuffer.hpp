@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// Push and pop never take a lock, the wait functions spin briefly and then block
+// on a condition variable until the other side makes progress.
+template <typename T>
+class SpscRingBuffer {
+ public:
+    explicit SpscRingBuffer(size_t capacity)
+        : slots(roundUpToPowerOfTwo(capacity)), mask(slots.size() - 1), limit(capacity), waiters(0), wakeups(0) {
+        head.value.store(0, std::memory_order_relaxed);
+        tail.value.store(0, std::memory_order_relaxed);
+        producerCache.value = 0;
+        consumerCache.value = 0;
+    }
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    // Producer: move item into the buffer, item is left untouched if the buffer is full
+    bool tryPush(T&& item) {
+        size_t currentTail = tail.value.load(std::memory_order_relaxed);
+
+        if (currentTail - producerCache.value >= limit) {
+            producerCache.value = head.value.load(std::memory_order_acquire);
+            if (currentTail - producerCache.value >= limit) {
+                return false;
+            }
+        }
+
+        slots[currentTail & mask] = std::move(item);
+        tail.value.store(currentTail + 1, std::memory_order_release);
+
+        notifyWaiters();
+        return true;
+    }
+
+    // Producer: push, waiting up to timeout for space
+    bool waitPush(T&& item, std::chrono::milliseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        while (!tryPush(std::move(item))) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline || !waitForSpace(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now))) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Consumer: move the oldest item out, returns false if the buffer is empty
+    bool tryPop(T& item) {
+        T* oldest = front();
+        if (!oldest) {
+            return false;
+        }
+
+        item = std::move(*oldest);
+        popFront();
+        return true;
+    }
+
+    // Consumer: peek at the oldest item without removing it, nullptr if empty
+    T* front() {
+        size_t currentHead = head.value.load(std::memory_order_relaxed);
+
+        if (currentHead == consumerCache.value) {
+            consumerCache.value = tail.value.load(std::memory_order_acquire);
+            if (currentHead == consumerCache.value) {
+                return nullptr;
+            }
+        }
+
+        return &slots[currentHead & mask];
+    }
+
+    // Consumer: remove the item returned by front()
+    void popFront() {
+        size_t currentHead = head.value.load(std::memory_order_relaxed);
+
+        // Release whatever the slot holds right away instead of when it is overwritten
+        slots[currentHead & mask] = T();
+        head.value.store(currentHead + 1, std::memory_order_release);
+
+        notifyWaiters();
+    }
+
+    // Consumer: drop all queued items
+    void clear() {
+        while (front()) {
+            popFront();
+        }
+    }
+
+    // Producer: wait until there is space, returns false on timeout or wakeAll()
+    bool waitForSpace(std::chrono::milliseconds timeout) {
+        return waitUntil([this] { return size() < limit; }, timeout);
+    }
+
+    // Consumer: wait until there is an item, returns false on timeout or wakeAll()
+    bool waitForData(std::chrono::milliseconds timeout) {
+        return waitUntil([this] { return size() > 0; }, timeout);
+    }
+
+    // Wake up any thread blocked in a wait function, e.g. when shutting down
+    void wakeAll() {
+        std::lock_guard<std::mutex> lock(waitMutex);
+        wakeups.fetch_add(1, std::memory_order_relaxed);
+        waitCondition.notify_all();
+    }
+
+    // Get queue state, exact only when called from the producer or consumer
+    size_t size() const {
+        // Read head first so the difference can never go negative
+        size_t currentHead = head.value.load(std::memory_order_acquire);
+        return tail.value.load(std::memory_order_acquire) - currentHead;
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() >= limit; }
+    size_t capacity() const { return limit; }
+
+ private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    static constexpr int SPIN_COUNT = 64;
+
+    // Keeps each index on its own cache line so producer and consumer do not false-share
+    template <typename V>
+    struct alignas(CACHE_LINE_SIZE) Padded {
+        V value;
+    };
+
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    template <typename Predicate>
+    bool waitUntil(Predicate ready, std::chrono::milliseconds timeout) {
+        // Most waits are short, spin before paying for a sleep
+        for (int i = 0; i < SPIN_COUNT; ++i) {
+            if (ready()) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        std::unique_lock<std::mutex> lock(waitMutex);
+        size_t wakeupsBefore = wakeups.load(std::memory_order_relaxed);
+
+        // Announce the waiter before re-checking, pairs with the fence in notifyWaiters()
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        bool result = waitCondition.wait_for(lock, timeout, [&] { return ready() || wakeups.load(std::memory_order_relaxed) != wakeupsBefore; });
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+
+        return result && ready();
+    }
+
+    void notifyWaiters() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) {
+            std::lock_guard<std::mutex> lock(waitMutex);
+            waitCondition.notify_all();
+        }
+    }
+
+    std::vector<T> slots;
+    const size_t mask;
+    const size_t limit;
+
+    Padded<std::atomic<size_t>> head;  // Next slot to pop, written by the consumer
+    Padded<std::atomic<size_t>> tail;  // Next slot to push, written by the producer
+    Padded<size_t> producerCache;      // Producer's last seen head
+    Padded<size_t> consumerCache;      // Consumer's last seen tail
+
+    std::mutex waitMutex;
+    std::condition_variable waitCondition;
+    std::atomic<int> waiters;
+    std::atomic<size_t> wakeups;
+};
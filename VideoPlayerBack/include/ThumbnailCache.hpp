@@ -0,0 +1,90 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Persistent thumbnail strips, one file per media file in a cache directory. A cache file holds a
+// fixed-size header keyed by the media file's path, size and modification time, an offset table and
+// the tightly packed RGBA tiles, so loading a strip is a single read-only mapping. The directory is
+// kept under a size limit by removing the least recently used files.
+class ThumbnailCache {
+ public:
+    // One thumbnail, pixels point into the mapping or the caller's buffer
+    struct Tile {
+        double pts;
+        sf::Vector2u size;  // (0, 0) for a thumbnail that could not be generated
+        const sf::Uint8* pixels;
+    };
+
+    // A cached strip mapped into memory, valid until closed or destroyed
+    class Strip {
+     public:
+        Strip();
+        ~Strip();
+
+        Strip(const Strip&) = delete;
+        Strip& operator=(const Strip&) = delete;
+
+        void close();
+        bool isOpen() const;
+
+        size_t getCount() const;
+        size_t getReadyCount() const;
+        double getDuration() const;
+
+        // Tile pointing into the mapping, false for a missing thumbnail
+        bool getTile(size_t index, Tile& tile) const;
+
+     private:
+        friend class ThumbnailCache;
+
+        const uint8_t* data;
+        size_t length;
+    };
+
+    explicit ThumbnailCache(const std::string& directory = getDefaultDirectory(), uint64_t maxSize = DEFAULT_MAX_SIZE);
+
+    // Map the strip cached for filename, false if there is none for its current size and modification time,
+    // it was generated with a different count or thumbnail size, or it misses tiles
+    bool load(const std::string& filename, size_t count, const sf::Vector2u& maxSize, Strip& strip) const;
+
+    // Store a strip, then evict the least recently used files over the size limit
+    bool save(const std::string& filename, const sf::Vector2u& maxSize, double duration, const std::vector<Tile>& tiles);
+
+    // Total size of the cache directory in bytes, 0 disables the limit
+    void setMaxSize(uint64_t bytes);
+    uint64_t getMaxSize() const;
+
+    // Remove least recently used files until the directory fits the size limit
+    void evict();
+
+    const std::string& getDirectory() const;
+
+    // Cache file belonging to a media file
+    std::string getCachePath(const std::string& filename) const;
+
+    // $XDG_CACHE_HOME/VideoPlayer/thumbnails, falling back to ~/.cache and the temporary directory
+    static std::string getDefaultDirectory();
+
+    static constexpr uint64_t DEFAULT_MAX_SIZE = 256ull * 1024 * 1024;
+
+ private:
+    std::string directory;
+    std::atomic<uint64_t> maxSize;
+
+    // Serializes writes and eviction when several generators share the cache
+    std::mutex mutex;
+
+    // Evict with mutex held
+    void evictLocked();
+
+    // Cache file layout: FileHeader, a TileEntry per thumbnail, then the pixels of every tile back to back
+    static constexpr char MAGIC[4] = {'V', 'P', 'T', 'H'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr const char* EXTENSION = ".vpthumb";
+};
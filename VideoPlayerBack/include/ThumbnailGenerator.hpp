@@ -0,0 +1,125 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+#include "ThumbnailCache.hpp"
+
+// Generates a strip of preview thumbnails at evenly spaced positions of a media file in the background.
+// Only keyframes are decoded, each worker thread has its own demuxer and decoder and runs at low
+// priority so playback decoding is not slowed down. The strip fills in coarse to fine order.
+// With a cache set, a strip generated before is mapped from it instead and new strips are saved to it.
+class ThumbnailGenerator {
+ public:
+    struct Thumbnail {
+        double pts;                     // Timestamp of the keyframe shown, in seconds
+        sf::Vector2u size;              // Fits inside the requested maximum size
+        std::vector<sf::Uint8> pixels;  // RGBA, size.x * size.y * 4 bytes
+    };
+
+    ThumbnailGenerator();
+    ~ThumbnailGenerator();
+
+    ThumbnailGenerator(const ThumbnailGenerator&) = delete;
+    ThumbnailGenerator& operator=(const ThumbnailGenerator&) = delete;
+
+    // Start generating count thumbnails of filename, each scaled to fit inside maxSize.
+    // Replaces the strip of a previous start().
+    bool start(const std::string& filename, size_t count, const sf::Vector2u& maxSize);
+
+    // Abort generation and discard the strip
+    void stop();
+
+    // Cache strips are loaded from and saved to, nullptr disables caching. Used by the next start().
+    void setCache(ThumbnailCache* cache);
+    ThumbnailCache* getCache() const;
+
+    // Worker threads used by the next start(), 0 picks a count from the number of cores
+    void setWorkerCount(unsigned int count);
+    unsigned int getWorkerCount() const;
+
+    // Strip state, complete once every worker has finished even if some positions failed
+    size_t getCount() const;
+    size_t getReadyCount() const;
+    bool isComplete() const;
+    bool isCached() const;
+
+    // Index of the thumbnail covering a position in seconds, 0 until the duration is known
+    size_t getIndex(double seconds) const;
+
+    // Copy a finished thumbnail, false while it is pending
+    bool getThumbnail(size_t index, Thumbnail& thumbnail) const;
+
+ private:
+    // Demuxer and decoder contexts of one worker, never shared between workers
+    struct WorkerContext {
+        AVFormatContext* formatContext = nullptr;
+        AVCodecContext* codecContext = nullptr;
+        SwsContext* swsContext = nullptr;
+        AVPacket* packet = nullptr;
+        AVFrame* frame = nullptr;
+        int streamIndex = -1;
+    };
+
+    struct Slot {
+        Thumbnail thumbnail;
+        bool ready = false;
+    };
+
+    std::string filename;
+    sf::Vector2u maxSize;
+    unsigned int workerCount;
+    ThumbnailCache* cache;
+
+    // Strip mapped from the cache, replaces generation when open
+    ThumbnailCache::Strip cachedStrip;
+
+    // Strip, guarded by mutex
+    std::vector<Slot> slots;
+    mutable std::mutex mutex;
+
+    // Thumbnail indices in generation order, workers take the next one from nextJob
+    std::vector<size_t> order;
+    std::atomic<size_t> nextJob;
+    std::atomic<size_t> readyCount;
+    std::atomic<double> duration;
+
+    std::vector<std::thread> workers;
+    std::atomic<unsigned int> activeWorkers;
+    std::atomic<bool> aborted;
+
+    // Packets a worker reads after a seek before giving up on finding a keyframe
+    static constexpr int MAX_PACKETS_PER_THUMBNAIL = 1000;
+
+    // Scheduling niceness of worker threads, the playback threads keep the default
+    static constexpr int WORKER_NICENESS = 10;
+
+    // Worker thread function
+    void workerLoop();
+
+    // Open the worker's own demuxer and keyframe-only decoder
+    bool openWorker(WorkerContext& worker);
+    static void closeWorker(WorkerContext& worker);
+
+    // Store the finished strip in the cache, called by the last worker
+    void saveToCache();
+
+    // Decode the first keyframe at or before seconds and scale it into thumbnail
+    bool decodeThumbnail(WorkerContext& worker, double seconds, Thumbnail& thumbnail);
+
+    // Size a width x height frame is scaled to
+    sf::Vector2u getScaledSize(int width, int height) const;
+
+    // 0, count / 2, count / 4, 3 * count / 4, ... so every prefix is spread over the whole strip
+    static std::vector<size_t> progressiveOrder(size_t count);
+};
@@ -2,10 +2,13 @@
 
 #include <SFML/Graphics.hpp>
 #include <atomic>
-#include <queue>
-#include <thread>
+#include <memory>
 
+#include "ColorConverter.hpp"
+#include "FrameBufferPool.hpp"
+#include "LatencyHistogram.hpp"
 #include "MediaDecoder.hpp"
+#include "SpscRingBuffer.hpp"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -13,34 +16,54 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+// Releases a decoded frame reference
+struct AVFrameDeleter {
+    void operator()(AVFrame* frame) const { av_frame_free(&frame); }
+};
+
 struct VideoFrame {
-    sf::Texture texture;
-    double pts;  // Presentation timestamp
+    std::unique_ptr<AVFrame, AVFrameDeleter> frame;  // Reference to the decoded picture, converted only when presented
+    double pts;                                      // Presentation timestamp
+    uint64_t epoch;                                  // Seek epoch the frame was decoded in
+    LatencyHistogram::Clock::time_point queuedTime;  // When the frame was queued, only set with STAGE_HISTOGRAMS
 };
 
 class VideoDecoder : public MediaDecoder {
  public:
+    // Filter used when frames are scaled down to the output size
+    enum ScalingQuality {
+        FAST,      // Fast bilinear, lowest cost
+        BILINEAR,  // Bilinear
+        BICUBIC    // Bicubic, sharpest
+    };
+
     VideoDecoder();
     ~VideoDecoder() override;
 
     // Initialize the video decoder after a file is opened
     bool initialize();
 
-    // Start the decoding thread
+    // Start decoding on the shared executor
     void start();
 
-    // Stop the decoding thread and clean up resources
+    // Stop decoding and clean up resources
     void stop();
 
     // Get next video frame
     bool getNextFrame(VideoFrame& frame);
 
+    // Get the pts of the next frame without removing it, false if no frame is queued
+    bool peekNextFramePts(double& pts);
+
     // Get video dimensions
     sf::Vector2u getSize() const;
 
     // Get frame rate
     double getFrameRate() const;
 
+    // Get number of threads the codec decodes with
+    int getThreadCount() const;
+
     // Check if decoder has more frames
     bool hasMoreFrames() const;
 
@@ -48,26 +71,103 @@ class VideoDecoder : public MediaDecoder {
     void setPaused(bool paused);
     bool isPaused() const;
 
+    // Decode only keyframes and output each one immediately, used while scrubbing
+    void setKeyframesOnly(bool enabled);
+
+    // Back RGBA conversion buffers with huge pages where available
+    void setHugePageBuffers(bool enabled);
+
+    // Get conversion buffer pool counters
+    FrameBufferPool::Stats getBufferPoolStats() const;
+
+    // Get queued frames and packets
+    QueueStats getQueueStats() const override;
+
+    // Limit converted frames to fit inside size, keeping the aspect ratio. (0, 0) converts at the native size.
+    // Frames are never scaled up. Must be called from the thread that renders the texture.
+    void setOutputSize(const sf::Vector2u& size);
+    sf::Vector2u getOutputSize() const;
+
+    // Set the filter used when scaling down to the output size
+    void setScalingQuality(ScalingQuality quality);
+    ScalingQuality getScalingQuality() const;
+
+    // Convert a decoded frame to RGBA at the output size into a pooled buffer, empty on failure.
+    // Must be called from a single thread, the one that renders when textures are updated as well.
+    FrameBufferPool::Buffer convertFrame(const AVFrame* frame, sf::Vector2u& size);
+
+    // Convert a decoded frame to RGBA and upload it into texture.
+    // Must be called from the thread that renders the texture.
+    bool convertFrameToTexture(const AVFrame* frame, sf::Texture& texture);
+
+    // Per-frame latencies of each stage since initialize(), empty unless built with STAGE_HISTOGRAMS
+    struct StageLatencies {
+        LatencyHistogram::Summary send;       // avcodec_send_packet() of one packet
+        LatencyHistogram::Summary receive;    // avcodec_receive_frame() returning a frame
+        LatencyHistogram::Summary queueWait;  // Frame queued until it was taken with getNextFrame()
+        LatencyHistogram::Summary convert;    // Conversion to RGBA
+        LatencyHistogram::Summary upload;     // Texture creation and update
+    };
+    StageLatencies getStageLatencies() const;
+
  private:
     AVCodecContext* codecContext;
     SwsContext* swsContext;
     AVStream* videoStream;
     int videoStreamIndex;
+    std::shared_ptr<PacketQueue> inputQueue;
+
+    // Recycled RGBA buffers for frame conversion
+    FrameBufferPool bufferPool;
+
+    // SIMD YUV to RGBA conversion for the common formats, swscale handles the rest
+    ColorConverter colorConverter;
 
-    std::queue<VideoFrame> frameQueue;
-    std::mutex queueMutex;
-    std::condition_variable queueCondition;
+    // Display size frames are scaled down to, (0, 0) for native size
+    sf::Vector2u outputSize;
+    ScalingQuality scalingQuality;
+
+    SpscRingBuffer<VideoFrame> frameQueue;
 
-    std::thread decodingThread;
     std::atomic<bool> running;
     std::atomic<bool> paused;
+    std::atomic<bool> keyframesOnly;
+
+    // Decoding state carried from one step to the next, only touched by the running step
+    AVPacket* codecPacket;
+    AVFrame* codecFrame;
+    EpochState epochState;
+    VideoFrame pendingFrame;  // Decoded frame the full queue refused, queued first by the next step
+    bool inputEnded;          // The end of stream packet was sent since the codec was last flushed
+    bool drainPending;        // A keyframe was sent and drained, the codec is flushed once its frame is out
+    double frameDuration;
+
+    // Stage latency histograms
+    LatencyHistogram sendLatency;
+    LatencyHistogram receiveLatency;
+    LatencyHistogram queueWaitLatency;
+    LatencyHistogram convertLatency;
+    LatencyHistogram uploadLatency;
 
     // Maximum number of frames to keep in queue
     static constexpr size_t MAX_QUEUE_SIZE = 30;
 
-    // Decoding thread function
-    void decodingLoop();
+    // Packets a step sends to the codec before it makes way for other decoders
+    static constexpr int STEP_PACKETS = 4;
+
+    // Decoding step, run on the shared executor
+    bool decodeStep() override;
+    double getQueuedSeconds() const override;
+
+    // Move the frames the codec has ready into the queue, false if the queue is full
+    bool receiveFrames();
+
+    // Consumer side: pop queued frames a later seek has superseded
+    void discardStaleFrames();
+
+    // Size a width x height frame is converted to for the current output size
+    sf::Vector2u getScaledSize(int width, int height) const;
 
-    // Convert AVFrame to SFML Texture
-    bool convertFrameToTexture(AVFrame* frame, sf::Texture& texture);
+    // Set up colorConverter for the frame's format, false if it has to go through swscale
+    bool configureColorConverter(const AVFrame* frame);
 };
@@ -1,14 +1,31 @@
 #include "../include/AudioDecoder.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 AudioDecoder::AudioDecoder()
-    : MediaDecoder(), codecContext(nullptr), swrContext(nullptr), audioStream(nullptr), audioStreamIndex(-1), running(false), paused(false) {
+    : MediaDecoder(),
+      codecContext(nullptr),
+      swrContext(nullptr),
+      audioStream(nullptr),
+      audioStreamIndex(-1),
+      inputQueue(nullptr),
+      packetQueue(MAX_QUEUE_SIZE),
+      running(false),
+      paused(false),
+      codecPacket(nullptr),
+      codecFrame(nullptr),
+      inputEnded(false),
+      packetDuration(0.0),
+      samplePool(MAX_QUEUE_SIZE + 4) {
 }
 
 AudioDecoder::~AudioDecoder() {
     stop();
 
+    av_packet_free(&codecPacket);
+    av_frame_free(&codecFrame);
+
     if (swrContext) {
         swr_free(&swrContext);
         swrContext = nullptr;
@@ -23,7 +40,7 @@ AudioDecoder::~AudioDecoder() {
 bool AudioDecoder::initialize() {
     std::lock_guard<std::mutex> lock(mutex);
 
-    if (!opened || !formatContext) {
+    if (!opened || !demuxer) {
         return false;
     }
 
@@ -34,38 +51,48 @@ bool AudioDecoder::initialize() {
         return false;
     }
 
-    audioStream = formatContext->streams[audioStreamIndex];
+    audioStream = demuxer->getStream(audioStreamIndex);
+
+    // Subscribe to the packets of the audio stream
+    inputQueue = demuxer->openStream(audioStreamIndex);
+    if (!inputQueue) {
+        errors.report(MediaPlayerException::STREAM_ERROR, "Failed to open audio packet queue");
+        return false;
+    }
 
     // Find decoder for the stream
     const AVCodec* codec = avcodec_find_decoder(audioStream->codecpar->codec_id);
     if (!codec) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::CODEC_ERROR, "Unsupported audio codec");
+        errors.report(MediaPlayerException::CODEC_ERROR, "Unsupported audio codec");
         return false;
     }
 
     // Allocate codec context
     codecContext = avcodec_alloc_context3(codec);
     if (!codecContext) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to allocate audio codec context");
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate audio codec context");
         return false;
     }
 
     // Copy codec parameters to context
     if (avcodec_parameters_to_context(codecContext, audioStream->codecpar) < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to copy audio codec parameters to context");
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to copy audio codec parameters to context");
         return false;
     }
 
+    // Decode on multiple threads where the codec supports it
+    applyThreading(codecContext, codec);
+
     // Open codec
     if (avcodec_open2(codecContext, codec, nullptr) < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to open audio codec");
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to open audio codec");
         return false;
     }
 
     // Create resampler context
     swrContext = swr_alloc();
     if (!swrContext) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to allocate audio resampler context");
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate audio resampler context");
         return false;
     }
 
@@ -79,7 +106,7 @@ bool AudioDecoder::initialize() {
 
     // Initialize resampler
     if (swr_init(swrContext) < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to initialize audio resampler");
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to initialize audio resampler");
         return false;
     }
 
@@ -89,7 +116,19 @@ bool AudioDecoder::initialize() {
 void AudioDecoder::start() {
     std::lock_guard<std::mutex> lock(mutex);
 
-    if (running) {
+    if (running || !opened) {
+        return;
+    }
+
+    if (!codecPacket) {
+        codecPacket = av_packet_alloc();
+    }
+    if (!codecFrame) {
+        codecFrame = av_frame_alloc();
+    }
+
+    if (!codecPacket || !codecFrame) {
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate audio packet or frame");
         return;
     }
 
@@ -97,12 +136,17 @@ void AudioDecoder::start() {
     paused = false;
 
     // Clear any existing packets
-    while (!packetQueue.empty()) {
-        packetQueue.pop();
-    }
+    packetQueue.clear();
+
+    epochState = EpochState();
+    inputEnded = false;
 
-    // Start decoding thread
-    decodingThread = std::thread(&AudioDecoder::decodingLoop, this);
+    // Decode whenever packets arrive, steps run on the shared executor
+    inputQueue->setPushCallback([this] { requestDecode(); });
+    startSteps();
+
+    // Make sure packets are flowing
+    demuxer->start();
 }
 
 void AudioDecoder::stop() {
@@ -117,35 +161,65 @@ void AudioDecoder::stop() {
         paused = false;
     }
 
-    // Notify condition variable to wake up thread
-    queueCondition.notify_all();
+    // No step is queued or running once this returns
+    inputQueue->setPushCallback(nullptr);
+    stopSteps();
 
-    // Wait for thread to finish
-    if (decodingThread.joinable()) {
-        decodingThread.join();
-    }
+    // Wake up a consumer waiting for a packet
+    packetQueue.wakeAll();
 
-    // Clear queue
-    std::lock_guard<std::mutex> lock(queueMutex);
-    while (!packetQueue.empty()) {
-        packetQueue.pop();
+    // Clear queue, keeping the sample buffers for the next start
+    while (AudioPacket* queued = packetQueue.front()) {
+        samplePool.release(std::move(queued->samples));
+        packetQueue.popFront();
     }
+
+    samplePool.release(std::move(pendingPacket.samples));
+    pendingPacket.samples.clear();
 }
 
 bool AudioDecoder::getNextPacket(AudioPacket& packet) {
-    std::lock_guard<std::mutex> lock(queueMutex);
+    // Packets decoded before the latest seek may still be queued, recycle them unplayed
+    while (AudioPacket* queued = packetQueue.front()) {
+        if (!isStaleEpoch(queued->epoch)) {
+            break;
+        }
+
+        samplePool.release(std::move(queued->samples));
+        packetQueue.popFront();
+        requestDecode();
+    }
 
-    if (packetQueue.empty()) {
+    // Lock-free, a decoder waiting for space runs again
+    if (!packetQueue.tryPop(packet)) {
         return false;
     }
 
-    packet = packetQueue.front();
-    packetQueue.pop();
+    requestDecode();
+    return true;
+}
 
-    // Notify decoding thread that a packet was consumed
-    queueCondition.notify_one();
+bool AudioDecoder::waitForPacket(std::chrono::milliseconds timeout) {
+    return packetQueue.waitForData(timeout);
+}
 
-    return true;
+void AudioDecoder::recycleSamples(std::vector<sf::Int16>&& samples) {
+    samplePool.release(std::move(samples));
+}
+
+SampleBufferPool::Stats AudioDecoder::getSamplePoolStats() const {
+    return samplePool.getStats();
+}
+
+MediaDecoder::QueueStats AudioDecoder::getQueueStats() const {
+    QueueStats stats{packetQueue.size(), 0, 0};
+
+    if (opened && inputQueue) {
+        stats.packets = inputQueue->size();
+        stats.packetBytes = inputQueue->byteSize();
+    }
+
+    return stats;
 }
 
 unsigned int AudioDecoder::getSampleRate() const {
@@ -164,6 +238,10 @@ unsigned int AudioDecoder::getChannelCount() const {
     return 2;  // We're resampling to stereo
 }
 
+int AudioDecoder::getThreadCount() const {
+    return activeThreadCount(codecContext);
+}
+
 bool AudioDecoder::hasMorePackets() const {
     return running && opened;
 }
@@ -172,8 +250,8 @@ void AudioDecoder::setPaused(bool paused) {
     this->paused = paused;
 
     if (!paused) {
-        // Notify thread to continue if it was waiting
-        queueCondition.notify_one();
+        // Continue where the last step stopped
+        requestDecode();
     }
 }
 
@@ -181,126 +259,125 @@ bool AudioDecoder::isPaused() const {
     return paused;
 }
 
-void AudioDecoder::decodingLoop() {
-    AVPacket* packet = av_packet_alloc();
-    AVFrame* frame = av_frame_alloc();
-
-    if (!packet || !frame) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to allocate audio packet or frame");
-
-        if (packet)
-            av_packet_free(&packet);
-        if (frame)
-            av_frame_free(&frame);
-
-        return;
-    }
-
-    while (running) {
-        // Check if paused
+bool AudioDecoder::decodeStep() {
+    for (int i = 0; i < STEP_PACKETS; ++i) {
         if (paused) {
-            std::unique_lock<std::mutex> lock(mutex);
-            queueCondition.wait(lock, [this] { return !paused || !running; });
+            return false;
+        }
 
-            if (!running) {
-                break;
-            }
+        // Frames the codec holds go out before it is fed more
+        if (!receiveFrames()) {
+            return false;
+        }
 
-            continue;
+        uint64_t packetEpoch;
+        if (!inputQueue->pop(codecPacket, packetEpoch, std::chrono::milliseconds(0))) {
+            return false;
         }
 
-        // Check if queue is full
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            if (packetQueue.size() >= MAX_QUEUE_SIZE) {
-                queueCondition.wait(lock, [this] { return packetQueue.size() < MAX_QUEUE_SIZE || !running; });
+        // Packets read before the latest seek are dropped without decoding
+        uint64_t previousEpoch = epochState.epoch;
+        if (!enterEpoch(epochState, packetEpoch, codecContext)) {
+            av_packet_unref(codecPacket);
+            continue;
+        }
 
-                if (!running) {
-                    break;
-                }
+        // A new epoch has flushed the codec. The resampler still holds the delayed samples of the old position,
+        // initializing it again drops them so the first packet after a seek starts at the new position.
+        if (epochState.epoch != previousEpoch) {
+            inputEnded = false;
 
-                continue;
+            if (swr_init(swrContext) < 0) {
+                errors.report(MediaPlayerException::DECODER_ERROR, "Failed to reset audio resampler after seek");
             }
         }
 
-        // Read packet
-        int readResult;
-        {
-            std::lock_guard<std::mutex> lock(mutex);
-
-            if (!formatContext) {
-                break;
-            }
+        // The empty packet at the end of the file drains the codec
+        inputEnded = inputEnded || isEndOfStreamPacket(codecPacket);
 
-            readResult = av_read_frame(formatContext, packet);
-        }
+        // Send packet to decoder
+        int sendResult = avcodec_send_packet(codecContext, codecPacket);
+        av_packet_unref(codecPacket);
 
-        if (readResult < 0) {
-            // End of file or error
-            if (readResult == AVERROR_EOF) {
-                // End of file, loop back to beginning
-                seek(0);
-                continue;
-            } else {
-                // Error
-                ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR,
-                                                        "Error reading audio frame: " + ErrorHandler::ffmpegErrorToString(readResult));
-                break;
-            }
+        if (sendResult < 0) {
+            errors.report(MediaPlayerException::DECODER_ERROR,
+                          "Error sending packet to audio decoder: " + ErrorHandler::ffmpegErrorToString(sendResult));
         }
+    }
 
-        // Check if this packet belongs to the audio stream
-        if (packet->stream_index != audioStreamIndex) {
-            av_packet_unref(packet);
-            continue;
-        }
+    // Frames of the last packet are received by the next step
+    return true;
+}
 
-        // Send packet to decoder
-        int sendResult = avcodec_send_packet(codecContext, packet);
-        av_packet_unref(packet);
+double AudioDecoder::getQueuedSeconds() const {
+    return packetQueue.size() * packetDuration;
+}
 
-        if (sendResult < 0) {
-            ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR,
-                                                    "Error sending packet to audio decoder: " + ErrorHandler::ffmpegErrorToString(sendResult));
-            break;
+bool AudioDecoder::receiveFrames() {
+    // Samples the full queue refused go first, unless a seek has superseded them
+    if (!pendingPacket.samples.empty()) {
+        if (!isStaleEpoch(pendingPacket.epoch) && !packetQueue.tryPush(std::move(pendingPacket))) {
+            return false;
         }
 
-        // Receive frames from decoder
-        while (running) {
-            int receiveResult = avcodec_receive_frame(codecContext, frame);
-
-            if (receiveResult == AVERROR(EAGAIN) || receiveResult == AVERROR_EOF) {
-                // Need more packets or end of stream
-                break;
-            } else if (receiveResult < 0) {
-                // Error
-                ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Error receiving frame from audio decoder: " +
-                                                                                                 ErrorHandler::ffmpegErrorToString(receiveResult));
-                break;
-            }
+        samplePool.release(std::move(pendingPacket.samples));
+        pendingPacket.samples.clear();
+    }
 
-            // Convert frame to audio samples and add to queue
-            AudioPacket audioPacket;
+    while (true) {
+        int receiveResult = avcodec_receive_frame(codecContext, codecFrame);
 
-            // Calculate presentation timestamp in seconds
-            double pts = 0.0;
-            if (frame->pts != AV_NOPTS_VALUE) {
-                pts = frame->pts * av_q2d(audioStream->time_base);
+        if (receiveResult == AVERROR(EAGAIN) || receiveResult == AVERROR_EOF) {
+            // Need more packets or end of stream, after the end of the file every packet is queued now
+            if (receiveResult == AVERROR_EOF && inputEnded) {
+                setEndOfStream(epochState);
             }
+            return true;
+        } else if (receiveResult < 0) {
+            // Error
+            errors.report(MediaPlayerException::DECODER_ERROR, "Error receiving frame from audio decoder: " +
+                                                                   ErrorHandler::ffmpegErrorToString(receiveResult));
+            return true;
+        }
 
-            audioPacket.pts = pts;
+        // Convert frame to audio samples in a recycled buffer and add to queue
+        AudioPacket audioPacket;
+        audioPacket.samples = samplePool.acquire();
 
-            if (convertFrameToSamples(frame, audioPacket.samples)) {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                packetQueue.push(audioPacket);
+        // Calculate presentation timestamp in seconds. The resampler outputs the samples it delayed from earlier
+        // frames first, so the packet starts that much before the frame. Right after a seek it holds none and
+        // trimToSeekTarget cuts at the exact sample.
+        double pts = 0.0;
+        if (codecFrame->pts != AV_NOPTS_VALUE) {
+            pts = codecFrame->pts * av_q2d(audioStream->time_base) - swr_get_delay(swrContext, 1000000) / 1e6;
+        }
+
+        audioPacket.pts = pts;
+        audioPacket.epoch = epochState.epoch;
+
+        // Output superseded by a seek is never resampled or queued
+        bool queued = false;
+        if (!isStaleEpoch(epochState.epoch) && convertFrameToSamples(codecFrame, audioPacket.samples) &&
+            trimToSeekTarget(epochState, audioPacket)) {
+            packetDuration = static_cast<double>(audioPacket.samples.size()) / getChannelCount() / getSampleRate();
+            decodedCount.fetch_add(1, std::memory_order_relaxed);
+            queued = packetQueue.tryPush(std::move(audioPacket));
+
+            // Hand the packet to the consumer, a full queue keeps it for the next step
+            if (!queued) {
+                pendingPacket = std::move(audioPacket);
+                av_frame_unref(codecFrame);
+                return false;
             }
+        }
 
-            av_frame_unref(frame);
+        // Recycle the samples if the packet was not queued
+        if (!queued) {
+            samplePool.release(std::move(audioPacket.samples));
         }
-    }
 
-    av_packet_free(&packet);
-    av_frame_free(&frame);
+        av_frame_unref(codecFrame);
+    }
 }
 
 bool AudioDecoder::convertFrameToSamples(AVFrame* frame, std::vector<sf::Int16>& samples) {
@@ -316,8 +393,7 @@ bool AudioDecoder::convertFrameToSamples(AVFrame* frame, std::vector<sf::Int16>&
     int samplesResampled = swr_convert(swrContext, &outBuffer, outSamples, (const uint8_t**)frame->data, frame->nb_samples);
 
     if (samplesResampled < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR,
-                                                "Error resampling audio: " + ErrorHandler::ffmpegErrorToString(samplesResampled));
+        errors.report(MediaPlayerException::DECODER_ERROR, "Error resampling audio: " + ErrorHandler::ffmpegErrorToString(samplesResampled));
         return false;
     }
 
@@ -326,3 +402,25 @@ bool AudioDecoder::convertFrameToSamples(AVFrame* frame, std::vector<sf::Int16>&
 
     return true;
 }
+
+bool AudioDecoder::trimToSeekTarget(EpochState& state, AudioPacket& packet) {
+    unsigned int channels = getChannelCount();
+    double sampleRate = getSampleRate();
+    double target = state.seekTarget;
+
+    double endPts = packet.pts + packet.samples.size() / channels / sampleRate;
+    if (skipBeforeSeekTarget(state, endPts)) {
+        return false;
+    }
+
+    // The packet straddles the target, start playback exactly at it
+    if (target > packet.pts) {
+        size_t skipped = static_cast<size_t>((target - packet.pts) * sampleRate + 0.5) * channels;
+        skipped = std::min(skipped, packet.samples.size());
+
+        packet.samples.erase(packet.samples.begin(), packet.samples.begin() + skipped);
+        packet.pts = target;
+    }
+
+    return !packet.samples.empty();
+}
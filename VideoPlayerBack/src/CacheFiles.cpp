@@ -0,0 +1,49 @@
+#include "../include/CacheFiles.hpp"
+
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <filesystem>
+
+std::string CacheFiles::getDirectory(const std::string& name) {
+    std::filesystem::path base;
+
+    if (const char* cacheHome = std::getenv("XDG_CACHE_HOME"); cacheHome && *cacheHome) {
+        base = cacheHome;
+    } else if (const char* home = std::getenv("HOME"); home && *home) {
+        base = std::filesystem::path(home) / ".cache";
+    } else {
+        std::error_code error;
+        base = std::filesystem::temp_directory_path(error);
+    }
+
+    return (base / "VideoPlayer" / name).string();
+}
+
+bool CacheFiles::getFileStamp(const std::string& filename, uint64_t& size, int64_t& modifiedTime) {
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0) {
+        return false;
+    }
+
+    size = static_cast<uint64_t>(info.st_size);
+    modifiedTime = static_cast<int64_t>(info.st_mtime);
+    return true;
+}
+
+uint64_t CacheFiles::getPathHash(const std::string& filename) {
+    std::error_code error;
+    std::string path = std::filesystem::absolute(filename, error).lexically_normal().string();
+    if (error) {
+        path = filename;
+    }
+
+    // 64-bit FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : path) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
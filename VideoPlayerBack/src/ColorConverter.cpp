@@ -0,0 +1,281 @@
+#include "../include/ColorConverter.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COLOR_CONVERTER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Coefficients = ColorConverter::Coefficients;
+
+constexpr int FRACTION_BITS = ColorConverter::FRACTION_BITS;
+constexpr int32_t ROUNDING = 1 << (FRACTION_BITS - 1);
+
+inline uint8_t clampToByte(int32_t value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+// Reference conversion of one pixel, every kernel produces exactly this result
+inline void convertPixel(int32_t y, int32_t u, int32_t v, const Coefficients& c, uint8_t* dst) {
+    int32_t luma = (y - c.yOffset) * c.yScale + ROUNDING;
+    u -= 128;
+    v -= 128;
+
+    dst[0] = clampToByte((luma + c.vToR * v) >> FRACTION_BITS);
+    dst[1] = clampToByte((luma + c.uToG * u + c.vToG * v) >> FRACTION_BITS);
+    dst[2] = clampToByte((luma + c.uToB * u) >> FRACTION_BITS);
+    dst[3] = 255;
+}
+
+// Row kernels convert pixels [start, width) of one row. Planar rows read separate U and V
+// planes, semi-planar rows read interleaved UV pairs from u and ignore v.
+using RowFunction = void (*)(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int start, int width, const Coefficients& c);
+
+void planarRowScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int start, int width, const Coefficients& c) {
+    for (int x = start; x < width; ++x) {
+        convertPixel(y[x], u[x / 2], v[x / 2], c, dst + x * 4);
+    }
+}
+
+void semiPlanarRowScalar(const uint8_t* y, const uint8_t* uv, const uint8_t*, uint8_t* dst, int start, int width, const Coefficients& c) {
+    for (int x = start; x < width; ++x) {
+        convertPixel(y[x], uv[(x / 2) * 2], uv[(x / 2) * 2 + 1], c, dst + x * 4);
+    }
+}
+
+#ifdef COLOR_CONVERTER_X86
+
+// Computes 4 pixels in 32-bit lanes from zero-extended Y, U and V
+__attribute__((target("sse4.1"))) inline void computeRgb4(__m128i y, __m128i u, __m128i v, const Coefficients& c, __m128i& r, __m128i& g,
+                                                          __m128i& b) {
+    __m128i luma = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(y, _mm_set1_epi32(c.yOffset)), _mm_set1_epi32(c.yScale)), _mm_set1_epi32(ROUNDING));
+    u = _mm_sub_epi32(u, _mm_set1_epi32(128));
+    v = _mm_sub_epi32(v, _mm_set1_epi32(128));
+
+    r = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(v, _mm_set1_epi32(c.vToR))), FRACTION_BITS);
+    g = _mm_srai_epi32(_mm_add_epi32(luma, _mm_add_epi32(_mm_mullo_epi32(u, _mm_set1_epi32(c.uToG)), _mm_mullo_epi32(v, _mm_set1_epi32(c.vToG)))),
+                       FRACTION_BITS);
+    b = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(u, _mm_set1_epi32(c.uToB))), FRACTION_BITS);
+}
+
+// Converts 8 pixels given 8 luma bytes and 8 already upsampled U and V bytes
+__attribute__((target("sse4.1"))) inline void convert8(__m128i y8, __m128i u8, __m128i v8, const Coefficients& c, uint8_t* dst) {
+    __m128i rLow, gLow, bLow, rHigh, gHigh, bHigh;
+    computeRgb4(_mm_cvtepu8_epi32(y8), _mm_cvtepu8_epi32(u8), _mm_cvtepu8_epi32(v8), c, rLow, gLow, bLow);
+    computeRgb4(_mm_cvtepu8_epi32(_mm_srli_si128(y8, 4)), _mm_cvtepu8_epi32(_mm_srli_si128(u8, 4)), _mm_cvtepu8_epi32(_mm_srli_si128(v8, 4)), c,
+                rHigh, gHigh, bHigh);
+
+    // Saturate to bytes, then interleave into RGBA
+    __m128i r = _mm_packus_epi16(_mm_packs_epi32(rLow, rHigh), _mm_setzero_si128());
+    __m128i g = _mm_packus_epi16(_mm_packs_epi32(gLow, gHigh), _mm_setzero_si128());
+    __m128i b = _mm_packus_epi16(_mm_packs_epi32(bLow, bHigh), _mm_setzero_si128());
+    __m128i rg = _mm_unpacklo_epi8(r, g);
+    __m128i ba = _mm_unpacklo_epi8(b, _mm_set1_epi8(static_cast<char>(0xFF)));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi16(rg, ba));
+}
+
+__attribute__((target("sse4.1"))) void planarRowSse41(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int, int width,
+                                                      const Coefficients& c) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        int32_t uBytes, vBytes;
+        std::memcpy(&uBytes, u + x / 2, sizeof(uBytes));
+        std::memcpy(&vBytes, v + x / 2, sizeof(vBytes));
+
+        // Duplicate each chroma sample for the two pixels it covers
+        __m128i u8 = _mm_cvtsi32_si128(uBytes);
+        __m128i v8 = _mm_cvtsi32_si128(vBytes);
+        convert8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), _mm_unpacklo_epi8(u8, u8), _mm_unpacklo_epi8(v8, v8), c, dst + x * 4);
+    }
+
+    planarRowScalar(y, u, v, dst, x, width, c);
+}
+
+__attribute__((target("sse4.1"))) void semiPlanarRowSse41(const uint8_t* y, const uint8_t* uv, const uint8_t* v, uint8_t* dst, int, int width,
+                                                          const Coefficients& c) {
+    const __m128i uShuffle = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i vShuffle = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i pairs = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(uv + x));
+        convert8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)), _mm_shuffle_epi8(pairs, uShuffle), _mm_shuffle_epi8(pairs, vShuffle), c,
+                 dst + x * 4);
+    }
+
+    semiPlanarRowScalar(y, uv, v, dst, x, width, c);
+}
+
+// Computes 8 pixels in 32-bit lanes from zero-extended Y, U and V
+__attribute__((target("avx2"))) inline void computeRgb8(__m256i y, __m256i u, __m256i v, const Coefficients& c, __m256i& r, __m256i& g,
+                                                        __m256i& b) {
+    __m256i luma = _mm256_mullo_epi32(_mm256_sub_epi32(y, _mm256_set1_epi32(c.yOffset)), _mm256_set1_epi32(c.yScale));
+    luma = _mm256_add_epi32(luma, _mm256_set1_epi32(ROUNDING));
+    u = _mm256_sub_epi32(u, _mm256_set1_epi32(128));
+    v = _mm256_sub_epi32(v, _mm256_set1_epi32(128));
+
+    r = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(v, _mm256_set1_epi32(c.vToR))), FRACTION_BITS);
+    g = _mm256_srai_epi32(
+        _mm256_add_epi32(luma, _mm256_add_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(c.uToG)), _mm256_mullo_epi32(v, _mm256_set1_epi32(c.vToG)))),
+        FRACTION_BITS);
+    b = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(u, _mm256_set1_epi32(c.uToB))), FRACTION_BITS);
+}
+
+// Converts 16 pixels given 16 luma bytes and 16 already upsampled U and V bytes
+__attribute__((target("avx2"))) inline void convert16(__m128i y16, __m128i u16, __m128i v16, const Coefficients& c, uint8_t* dst) {
+    __m256i rLow, gLow, bLow, rHigh, gHigh, bHigh;
+    computeRgb8(_mm256_cvtepu8_epi32(y16), _mm256_cvtepu8_epi32(u16), _mm256_cvtepu8_epi32(v16), c, rLow, gLow, bLow);
+    computeRgb8(_mm256_cvtepu8_epi32(_mm_srli_si128(y16, 8)), _mm256_cvtepu8_epi32(_mm_srli_si128(u16, 8)),
+                _mm256_cvtepu8_epi32(_mm_srli_si128(v16, 8)), c, rHigh, gHigh, bHigh);
+
+    // Packs work per 128-bit lane, the permutes restore pixel order after each pack
+    __m256i r16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(rLow, rHigh), 0xD8);
+    __m256i g16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(gLow, gHigh), 0xD8);
+    __m256i b16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(bLow, bHigh), 0xD8);
+    __m256i rg8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(r16, g16), 0xD8);
+    __m256i ba8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(b16, _mm256_set1_epi16(0xFF)), 0xD8);
+
+    __m128i r = _mm256_castsi256_si128(rg8);
+    __m128i g = _mm256_extracti128_si256(rg8, 1);
+    __m128i b = _mm256_castsi256_si128(ba8);
+    __m128i a = _mm256_extracti128_si256(ba8, 1);
+
+    __m128i rgLow = _mm_unpacklo_epi8(r, g);
+    __m128i rgHigh = _mm_unpackhi_epi8(r, g);
+    __m128i baLow = _mm_unpacklo_epi8(b, a);
+    __m128i baHigh = _mm_unpackhi_epi8(b, a);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_set_m128i(_mm_unpackhi_epi16(rgLow, baLow), _mm_unpacklo_epi16(rgLow, baLow)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 32),
+                        _mm256_set_m128i(_mm_unpackhi_epi16(rgHigh, baHigh), _mm_unpacklo_epi16(rgHigh, baHigh)));
+}
+
+__attribute__((target("avx2"))) void planarRowAvx2(const uint8_t* y, const uint8_t* u, const uint8_t* v, uint8_t* dst, int, int width,
+                                                   const Coefficients& c) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        // Duplicate each chroma sample for the two pixels it covers
+        __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + x / 2));
+        __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + x / 2));
+        convert16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x)), _mm_unpacklo_epi8(u8, u8), _mm_unpacklo_epi8(v8, v8), c, dst + x * 4);
+    }
+
+    planarRowScalar(y, u, v, dst, x, width, c);
+}
+
+__attribute__((target("avx2"))) void semiPlanarRowAvx2(const uint8_t* y, const uint8_t* uv, const uint8_t* v, uint8_t* dst, int, int width,
+                                                       const Coefficients& c) {
+    const __m128i uShuffle = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 8, 8, 10, 10, 12, 12, 14, 14);
+    const __m128i vShuffle = _mm_setr_epi8(1, 1, 3, 3, 5, 5, 7, 7, 9, 9, 11, 11, 13, 13, 15, 15);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i pairs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv + x));
+        convert16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x)), _mm_shuffle_epi8(pairs, uShuffle), _mm_shuffle_epi8(pairs, vShuffle), c,
+                  dst + x * 4);
+    }
+
+    semiPlanarRowScalar(y, uv, v, dst, x, width, c);
+}
+
+#endif
+
+}  // namespace
+
+ColorConverter::ColorConverter() : layout(YUV420P), matrix(BT601), range(LIMITED), implementation(detectImplementation()) {
+    coefficients = computeCoefficients(matrix, range);
+}
+
+void ColorConverter::configure(PixelLayout layout, Matrix matrix, Range range) {
+    if (layout == this->layout && matrix == this->matrix && range == this->range) {
+        return;
+    }
+
+    this->layout = layout;
+    this->matrix = matrix;
+    this->range = range;
+    coefficients = computeCoefficients(matrix, range);
+}
+
+void ColorConverter::convert(const uint8_t* const src[], const int srcStride[], int width, int height, uint8_t* dst, int dstStride) const {
+    bool semiPlanar = layout == NV12;
+    bool verticalSubsampling = layout != YUV422P;
+
+    RowFunction row = semiPlanar ? semiPlanarRowScalar : planarRowScalar;
+
+#ifdef COLOR_CONVERTER_X86
+    if (implementation == AVX2) {
+        row = semiPlanar ? semiPlanarRowAvx2 : planarRowAvx2;
+    } else if (implementation == SSE41) {
+        row = semiPlanar ? semiPlanarRowSse41 : planarRowSse41;
+    }
+#endif
+
+    for (int y = 0; y < height; ++y) {
+        int chromaRow = verticalSubsampling ? y / 2 : y;
+
+        const uint8_t* luma = src[0] + static_cast<ptrdiff_t>(y) * srcStride[0];
+        const uint8_t* u = src[1] + static_cast<ptrdiff_t>(chromaRow) * srcStride[1];
+        const uint8_t* v = semiPlanar ? nullptr : src[2] + static_cast<ptrdiff_t>(chromaRow) * srcStride[2];
+
+        row(luma, u, v, dst + static_cast<ptrdiff_t>(y) * dstStride, 0, width, coefficients);
+    }
+}
+
+ColorConverter::Implementation ColorConverter::getImplementation() const {
+    return implementation;
+}
+
+void ColorConverter::setImplementation(Implementation implementation) {
+    Implementation supported = detectImplementation();
+    this->implementation = implementation > supported ? supported : implementation;
+}
+
+ColorConverter::Implementation ColorConverter::detectImplementation() {
+#ifdef COLOR_CONVERTER_X86
+    // Checked once, CPUID does not change while running
+    static const Implementation detected = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return AVX2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return SSE41;
+        }
+        return SCALAR;
+    }();
+
+    return detected;
+#else
+    return SCALAR;
+#endif
+}
+
+ColorConverter::Coefficients ColorConverter::computeCoefficients(Matrix matrix, Range range) {
+    // Luma weights of red and blue for each matrix
+    double kr = matrix == BT709 ? 0.2126 : 0.299;
+    double kb = matrix == BT709 ? 0.0722 : 0.114;
+    double kg = 1.0 - kr - kb;
+
+    // Limited range stretches 219 luma and 224 chroma steps to the full byte
+    double lumaScale = range == FULL ? 1.0 : 255.0 / 219.0;
+    double chromaScale = range == FULL ? 1.0 : 255.0 / 224.0;
+
+    auto fixed = [](double value) { return static_cast<int32_t>(std::lround(value * (1 << FRACTION_BITS))); };
+
+    Coefficients c;
+    c.yOffset = range == FULL ? 0 : 16;
+    c.yScale = fixed(lumaScale);
+    c.vToR = fixed(2.0 * (1.0 - kr) * chromaScale);
+    c.uToG = fixed(-2.0 * (1.0 - kb) * kb / kg * chromaScale);
+    c.vToG = fixed(-2.0 * (1.0 - kr) * kr / kg * chromaScale);
+    c.uToB = fixed(2.0 * (1.0 - kb) * chromaScale);
+    return c;
+}
@@ -0,0 +1,112 @@
+#include "../include/DecodeExecutor.hpp"
+
+#include <algorithm>
+
+thread_local int DecodeExecutor::currentWorker = -1;
+
+DecodeExecutor::DecodeExecutor(unsigned int workerCount)
+    : queuedTasks(0), stopping(false), nextSequence(0), nextWorker(0), executedTasks(0), stolenTasks(0) {
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    // Start threads once every queue exists, they steal from each other right away
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers[i]->thread = std::thread(&DecodeExecutor::workerLoop, this, i);
+    }
+}
+
+DecodeExecutor::~DecodeExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+DecodeExecutor& DecodeExecutor::getShared() {
+    static DecodeExecutor* shared = new DecodeExecutor();
+    return *shared;
+}
+
+void DecodeExecutor::submit(Clock::time_point deadline, Task task) {
+    size_t index = currentWorker >= 0 ? static_cast<size_t>(currentWorker) : nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+    Worker& worker = *workers[index];
+
+    // Counted before it is queued so the count never drops below zero, a worker woken a moment early looks again
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queuedTasks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.heap.push_back({deadline, nextSequence.fetch_add(1, std::memory_order_relaxed), std::move(task)});
+        std::push_heap(worker.heap.begin(), worker.heap.end(), LaterDeadline());
+    }
+
+    sleepCondition.notify_one();
+}
+
+unsigned int DecodeExecutor::getWorkerCount() const {
+    return static_cast<unsigned int>(workers.size());
+}
+
+DecodeExecutor::Stats DecodeExecutor::getStats() const {
+    return Stats{executedTasks.load(std::memory_order_relaxed), stolenTasks.load(std::memory_order_relaxed)};
+}
+
+void DecodeExecutor::workerLoop(size_t index) {
+    currentWorker = static_cast<int>(index);
+    Entry entry;
+
+    while (true) {
+        // Own queue first, then the other queues starting with the next worker
+        bool found = takeTask(*workers[index], entry);
+        for (size_t i = 1; !found && i < workers.size(); ++i) {
+            found = takeTask(*workers[(index + i) % workers.size()], entry);
+            if (found) {
+                stolenTasks.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (found) {
+            entry.task();
+            entry.task = nullptr;
+            executedTasks.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this] { return queuedTasks.load(std::memory_order_relaxed) > 0 || stopping; });
+
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+bool DecodeExecutor::takeTask(Worker& worker, Entry& entry) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+
+    if (worker.heap.empty()) {
+        return false;
+    }
+
+    std::pop_heap(worker.heap.begin(), worker.heap.end(), LaterDeadline());
+    entry = std::move(worker.heap.back());
+    worker.heap.pop_back();
+
+    queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,703 @@
+#include "../include/Demuxer.hpp"
+
+#include "../include/MappedFileInput.hpp"
+#include "../include/PrefetchInput.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// Demuxers that find the next packet from any byte offset: MPEG transport and program streams and raw
+// elementary streams. Other containers resolve a byte seek through their own index or not at all.
+const char* const BYTE_SEEK_FORMATS[] = {"mpegts", "mpeg", "mpegvideo", "h264", "hevc", "m4v", "aac", "ac3", "eac3", "mp3"};
+
+// Check whether any of the comma-separated names of a demuxer is in BYTE_SEEK_FORMATS
+bool resyncsOnBytes(const AVInputFormat* format) {
+    if (!format || !format->name || (format->flags & AVFMT_NO_BYTE_SEEK)) {
+        return false;
+    }
+
+    const char* name = format->name;
+    while (*name) {
+        size_t length = std::strcspn(name, ",");
+        for (const char* byteSeekFormat : BYTE_SEEK_FORMATS) {
+            if (std::strlen(byteSeekFormat) == length && std::strncmp(name, byteSeekFormat, length) == 0) {
+                return true;
+            }
+        }
+
+        name += name[length] == ',' ? length + 1 : length;
+    }
+
+    return false;
+}
+
+}  // namespace
+
+Demuxer::Demuxer()
+    : formatContext(nullptr),
+      inputMode(FILE_PROTOCOL),
+      prefetchWindow(PrefetchInput::DEFAULT_WINDOW_SIZE),
+      opened(false),
+      running(false),
+      pendingRequest{0.0, false},
+      requestedSeeks(0),
+      performedSeeks(0),
+      seekTarget(-1.0),
+      seekRequested(false),
+      seekEpoch(0),
+      scrubbing(false),
+      coalescedSeeks(0),
+      looping(true),
+      endOfFile(false),
+      indexingAborted(false),
+      indexingEnabled(true),
+      firstPacketRead(false),
+      packetsRead(0),
+      readNanoseconds(0),
+      bytesRead(0) {
+}
+
+Demuxer::~Demuxer() {
+    close();
+}
+
+bool Demuxer::open(const std::string& filename) {
+    // Close any previously opened file
+    close();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->filename = filename;
+
+    // Open the input file
+    formatContext = avformat_alloc_context();
+    if (!formatContext) {
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate format context");
+        return false;
+    }
+
+    // Read through a custom input if one is selected and can open the file
+    input = createInput();
+    if (input && input->open(filename)) {
+        formatContext->pb = input->getContext();
+    } else {
+        input.reset();
+    }
+
+    // Bound probing, FFmpeg otherwise reads up to several megabytes before the first packet is available
+    formatContext->probesize = PROBE_SIZE;
+    formatContext->max_analyze_duration = ANALYZE_DURATION;
+
+    // Open input file
+    int result = avformat_open_input(&formatContext, filename.c_str(), nullptr, nullptr);
+    if (result < 0) {
+        errors.report(MediaPlayerException::FILE_NOT_FOUND, "Could not open file: " + filename + " - " + ErrorHandler::ffmpegErrorToString(result));
+        avformat_free_context(formatContext);
+        formatContext = nullptr;
+        input.reset();
+        return false;
+    }
+
+    // Find stream info
+    result = avformat_find_stream_info(formatContext, nullptr);
+
+    // Probe again with the default limits if the bounded probe was not enough
+    if (result >= 0 && !streamsDescribed()) {
+        formatContext->probesize = DEFAULT_PROBE_SIZE;
+        formatContext->max_analyze_duration = 0;
+        result = avformat_find_stream_info(formatContext, nullptr);
+    }
+    if (result < 0) {
+        errors.report(MediaPlayerException::FORMAT_ERROR, "Could not find stream information: " + ErrorHandler::ffmpegErrorToString(result));
+        avformat_close_input(&formatContext);
+        formatContext = nullptr;
+        input.reset();
+        return false;
+    }
+
+    opened = true;
+    firstPacketRead = false;
+    endOfFile = false;
+    packetsRead = 0;
+    readNanoseconds = 0;
+    bytesRead = 0;
+    readLatency.reset();
+
+    // Index the file while playback starts
+    if (indexingEnabled) {
+        indexingAborted = false;
+        indexingThread = std::thread(&Demuxer::indexingLoop, this, filename, createInput());
+    }
+
+    return true;
+}
+
+void Demuxer::close() {
+    stop();
+    stopIndexing();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    packetIndex.reset();
+
+    if (formatContext) {
+        avformat_close_input(&formatContext);
+        formatContext = nullptr;
+    }
+
+    // A custom input outlives the format context reading through it
+    input.reset();
+
+    // Decoders still attached keep their queues, they receive nothing more
+    streamQueues.clear();
+    opened = false;
+}
+
+void Demuxer::setInputMode(InputMode mode) {
+    std::lock_guard<std::mutex> lock(mutex);
+    inputMode = mode;
+}
+
+Demuxer::InputMode Demuxer::getInputMode() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return inputMode;
+}
+
+void Demuxer::setPrefetchWindow(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    prefetchWindow = bytes;
+}
+
+size_t Demuxer::getPrefetchWindow() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return prefetchWindow;
+}
+
+MediaInput::Stats Demuxer::getInputStats() const {
+    // Not under mutex, the demuxing thread holds it while a read stalls
+    if (!input) {
+        return MediaInput::Stats{0, 0, 0, 0.0, 0.0};
+    }
+
+    return input->getStats();
+}
+
+Demuxer::ReadStats Demuxer::getReadStats() const {
+    return ReadStats{packetsRead.load(std::memory_order_relaxed), readNanoseconds.load(std::memory_order_relaxed) / 1e9,
+                     bytesRead.load(std::memory_order_relaxed)};
+}
+
+LatencyHistogram::Summary Demuxer::getReadLatency() const {
+    return readLatency.getSummary();
+}
+
+void Demuxer::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running || !opened) {
+        return;
+    }
+
+    running = true;
+
+    // Start demuxing thread
+    demuxingThread = std::thread(&Demuxer::demuxingLoop, this);
+}
+
+void Demuxer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!running) {
+            return;
+        }
+
+        running = false;
+    }
+
+    // Wake up thread if it is waiting for queue space
+    wakeCondition.notify_all();
+
+    // Wait for thread to finish
+    if (demuxingThread.joinable()) {
+        demuxingThread.join();
+    }
+
+    flushQueues(seekEpoch);
+}
+
+bool Demuxer::seek(double seconds, bool exact) {
+    bool result;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // An explicit seek supersedes any request still waiting for the demuxing thread
+        {
+            std::lock_guard<std::mutex> seekLock(seekMutex);
+            seekRequested = false;
+            performedSeeks = requestedSeeks;
+        }
+
+        result = seekLocked(seconds, exact);
+    }
+
+    wakeCondition.notify_all();
+
+    return result;
+}
+
+void Demuxer::requestSeek(double seconds, bool exact) {
+    if (!running) {
+        seek(seconds, exact);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(seekMutex);
+
+        if (seekRequested) {
+            ++coalescedSeeks;
+        }
+
+        pendingRequest = {seconds, exact};
+        ++requestedSeeks;
+        seekRequested = true;
+    }
+
+    wakeCondition.notify_all();
+}
+
+bool Demuxer::isSeekPending() const {
+    std::lock_guard<std::mutex> lock(seekMutex);
+    return performedSeeks != requestedSeeks;
+}
+
+uint64_t Demuxer::getSeekEpoch() const {
+    return seekEpoch;
+}
+
+double Demuxer::getSeekTarget(uint64_t epoch) const {
+    std::lock_guard<std::mutex> lock(seekMutex);
+    return epoch == seekEpoch ? seekTarget : -1.0;
+}
+
+void Demuxer::setScrubbing(bool enabled) {
+    scrubbing = enabled;
+    wakeCondition.notify_all();
+}
+
+bool Demuxer::isScrubbing() const {
+    return scrubbing;
+}
+
+size_t Demuxer::getCoalescedSeekCount() const {
+    return coalescedSeeks;
+}
+
+void Demuxer::setLooping(bool enabled) {
+    looping = enabled;
+}
+
+bool Demuxer::isLooping() const {
+    return looping;
+}
+
+bool Demuxer::isEndOfFile() const {
+    return endOfFile;
+}
+
+double Demuxer::getDuration() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!opened || !formatContext) {
+        return 0.0;
+    }
+
+    if (formatContext->duration == AV_NOPTS_VALUE) {
+        return 0.0;
+    }
+
+    return static_cast<double>(formatContext->duration) / AV_TIME_BASE;
+}
+
+bool Demuxer::isOpen() const {
+    return opened;
+}
+
+int Demuxer::findStream(AVMediaType type) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!opened || !formatContext) {
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < formatContext->nb_streams; ++i) {
+        if (formatContext->streams[i]->codecpar->codec_type == type) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+AVStream* Demuxer::getStream(int streamIndex) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!opened || !formatContext || streamIndex < 0 || streamIndex >= static_cast<int>(formatContext->nb_streams)) {
+        return nullptr;
+    }
+
+    return formatContext->streams[streamIndex];
+}
+
+std::shared_ptr<PacketQueue> Demuxer::openStream(int streamIndex) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!opened || !formatContext || streamIndex < 0 || streamIndex >= static_cast<int>(formatContext->nb_streams)) {
+        return nullptr;
+    }
+
+    std::shared_ptr<PacketQueue>& queue = streamQueues[streamIndex];
+    if (!queue) {
+        queue = std::make_shared<PacketQueue>();
+
+        // Resume reading as soon as a consumer makes room
+        queue->setPopCallback([this] { wakeCondition.notify_one(); });
+    }
+
+    return queue;
+}
+
+void Demuxer::setIndexing(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex);
+    indexingEnabled = enabled;
+}
+
+std::shared_ptr<const PacketIndex> Demuxer::getIndex() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return packetIndex;
+}
+
+bool Demuxer::getFirstPacketTime(std::chrono::steady_clock::time_point& time) const {
+    if (!firstPacketRead) {
+        return false;
+    }
+
+    time = firstPacketTime;
+    return true;
+}
+
+ErrorChannel& Demuxer::getErrorChannel() {
+    return errors;
+}
+
+void Demuxer::demuxingLoop() {
+    AVPacket* packet = av_packet_alloc();
+
+    if (!packet) {
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate demuxer packet");
+        return;
+    }
+
+    // Set once the keyframe for the current scrub position has been delivered
+    bool scrubFrameDelivered = false;
+
+    while (running) {
+        // Perform the latest requested seek, requests made while it waited have replaced older ones
+        if (seekRequested && performRequestedSeek()) {
+            scrubFrameDelivered = false;
+        }
+
+        // While scrubbing, nothing more is read until the next position is requested
+        if (scrubbing && scrubFrameDelivered) {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(10), [this] { return seekRequested || !scrubbing || !running; });
+            continue;
+        }
+
+        // A file that does not loop stays at its end until the next seek
+        if (endOfFile) {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(10), [this] { return !endOfFile || seekRequested || !running; });
+            continue;
+        }
+
+        // Check if queues are full
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            if (queuesFull()) {
+                wakeCondition.wait_for(lock, std::chrono::milliseconds(10), [this] { return !queuesFull() || seekRequested || !running; });
+                continue;
+            }
+        }
+
+        // Read packet
+        int readResult;
+        uint64_t readEpoch;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!formatContext) {
+                break;
+            }
+
+            // Seeks happen under the same lock, so the packet belongs to this epoch
+            readEpoch = seekEpoch;
+            auto readStart = std::chrono::steady_clock::now();
+            readResult = av_read_frame(formatContext, packet);
+            int64_t readTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - readStart).count();
+            readNanoseconds.fetch_add(readTime, std::memory_order_relaxed);
+            readLatency.recordNanoseconds(readTime);
+
+            if (readResult == AVERROR_EOF && looping) {
+                // End of file, loop back to beginning
+                av_seek_frame(formatContext, -1, 0, AVSEEK_FLAG_BACKWARD);
+                continue;
+            }
+
+            // A read that failed for good ends the file like its end, a later seek may still recover
+            if (readResult < 0 && readResult != AVERROR(EAGAIN)) {
+                endOfFile = true;
+            }
+        }
+
+        // Inputs such as network streams have no data yet, try again shortly
+        if (readResult == AVERROR(EAGAIN)) {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCondition.wait_for(lock, std::chrono::milliseconds(10), [this] { return seekRequested || !running; });
+            continue;
+        }
+
+        if (readResult < 0 && readResult != AVERROR_EOF) {
+            errors.report(MediaPlayerException::DECODER_ERROR, "Error reading packet: " + ErrorHandler::ffmpegErrorToString(readResult));
+        }
+
+        // Tell every decoder the file has ended, the empty packet is refused if a seek came first
+        if (readResult < 0) {
+            av_packet_unref(packet);
+            for (auto& entry : streamQueues) {
+                entry.second->push(packet, readEpoch);
+            }
+            continue;
+        }
+
+        packetsRead.fetch_add(1, std::memory_order_relaxed);
+        bytesRead.fetch_add(packet->size, std::memory_order_relaxed);
+
+        // While scrubbing only the first video keyframe after the seek is needed
+        if (scrubbing && !isVideoKeyframe(packet)) {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        // Route packet to the queue of its stream, drop packets nobody consumes
+        auto it = streamQueues.find(packet->stream_index);
+        if (it != streamQueues.end()) {
+            // Refused if a seek has flushed the queue since the packet was read
+            if (it->second->push(packet, readEpoch)) {
+                scrubFrameDelivered = true;
+
+                if (!firstPacketRead) {
+                    firstPacketTime = std::chrono::steady_clock::now();
+                    firstPacketRead = true;
+                }
+            }
+        }
+
+        av_packet_unref(packet);
+    }
+
+    av_packet_free(&packet);
+}
+
+bool Demuxer::streamsDescribed() const {
+    for (unsigned int i = 0; i < formatContext->nb_streams; ++i) {
+        const AVCodecParameters* parameters = formatContext->streams[i]->codecpar;
+
+        if (parameters->codec_type == AVMEDIA_TYPE_VIDEO && (parameters->width <= 0 || parameters->height <= 0 || parameters->format < 0)) {
+            return false;
+        }
+
+        if (parameters->codec_type == AVMEDIA_TYPE_AUDIO && (parameters->sample_rate <= 0 || parameters->format < 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Demuxer::queuesFull() const {
+    if (streamQueues.empty()) {
+        return true;
+    }
+
+    size_t totalBytes = 0;
+    bool allStreamsFilled = true;
+
+    for (const auto& entry : streamQueues) {
+        totalBytes += entry.second->byteSize();
+        if (entry.second->size() < MIN_QUEUE_PACKETS) {
+            allStreamsFilled = false;
+        }
+    }
+
+    return allStreamsFilled || totalBytes >= MAX_QUEUE_BYTES;
+}
+
+bool Demuxer::isVideoKeyframe(const AVPacket* packet) const {
+    if (!(packet->flags & AV_PKT_FLAG_KEY) || packet->stream_index < 0 || packet->stream_index >= static_cast<int>(formatContext->nb_streams)) {
+        return false;
+    }
+
+    return formatContext->streams[packet->stream_index]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO;
+}
+
+bool Demuxer::seekLocked(double seconds, bool exact) {
+    if (!opened || !formatContext) {
+        errors.report(MediaPlayerException::DECODER_ERROR, "Cannot seek: no file is open");
+        return false;
+    }
+
+    // Jump straight to the indexed keyframe if possible, otherwise let the container find it
+    if (!seekWithIndex(seconds)) {
+        // Convert seconds to timestamp
+        int64_t timestamp = static_cast<int64_t>(seconds * AV_TIME_BASE);
+
+        // Seek to the timestamp
+        int result = av_seek_frame(formatContext, -1, timestamp, AVSEEK_FLAG_BACKWARD);
+        if (result < 0) {
+            errors.report(MediaPlayerException::DECODER_ERROR, "Seek failed: " + ErrorHandler::ffmpegErrorToString(result));
+            return false;
+        }
+    }
+
+    // Start a new epoch, everything read or decoded before it is stale
+    uint64_t epoch;
+    {
+        std::lock_guard<std::mutex> seekLock(seekMutex);
+        seekTarget = exact ? seconds : -1.0;
+        epoch = ++seekEpoch;
+    }
+
+    // Reading resumes at a file's end
+    endOfFile = false;
+
+    // Packets from the old position are no longer needed
+    flushQueues(epoch);
+
+    return true;
+}
+
+bool Demuxer::performRequestedSeek() {
+    // Taking and performing the request under the mutex keeps it from overtaking a later explicit seek
+    std::lock_guard<std::mutex> lock(mutex);
+
+    SeekRequest request;
+    uint64_t requestNumber;
+    {
+        std::lock_guard<std::mutex> seekLock(seekMutex);
+
+        if (!seekRequested) {
+            return false;
+        }
+
+        request = pendingRequest;
+        requestNumber = requestedSeeks;
+        seekRequested = false;
+    }
+
+    seekLocked(request.seconds, request.exact);
+
+    std::lock_guard<std::mutex> seekLock(seekMutex);
+    performedSeeks = std::max(performedSeeks, requestNumber);
+
+    return true;
+}
+
+void Demuxer::flushQueues(uint64_t epoch) {
+    for (auto& entry : streamQueues) {
+        entry.second->flush(epoch);
+    }
+}
+
+void Demuxer::indexingLoop(std::string filename, std::unique_ptr<MediaInput> indexInput) {
+    auto index = std::make_shared<PacketIndex>();
+
+    // A missing or outdated cached index is rebuilt, failing to save it only costs a rebuild next time
+    if (!index->load(filename)) {
+        if (indexInput && !indexInput->open(filename)) {
+            indexInput.reset();
+        }
+
+        if (!index->build(filename, indexingAborted, indexInput.get())) {
+            return;
+        }
+
+        index->save(filename);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    packetIndex = std::move(index);
+}
+
+std::unique_ptr<MediaInput> Demuxer::createInput() const {
+    switch (inputMode) {
+        case MEMORY_MAPPED:
+            return std::make_unique<MappedFileInput>();
+        case PREFETCH:
+            return std::make_unique<PrefetchInput>(prefetchWindow);
+        default:
+            return nullptr;
+    }
+}
+
+void Demuxer::stopIndexing() {
+    indexingAborted = true;
+
+    if (indexingThread.joinable()) {
+        indexingThread.join();
+    }
+}
+
+bool Demuxer::seekWithIndex(double seconds) {
+    if (!packetIndex) {
+        return false;
+    }
+
+    // Seek on the video keyframes, or the first indexed stream for audio-only files
+    int streamIndex = -1;
+    for (unsigned int i = 0; i < formatContext->nb_streams; ++i) {
+        if (!packetIndex->hasStream(i)) {
+            continue;
+        }
+
+        if (streamIndex < 0 || formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            streamIndex = i;
+        }
+
+        if (formatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            break;
+        }
+    }
+
+    const PacketIndex::Entry* keyframe = streamIndex >= 0 ? packetIndex->findKeyframe(streamIndex, seconds) : nullptr;
+    if (!keyframe) {
+        return false;
+    }
+
+    // Landing on the keyframe's bytes skips the demuxer's own search, only safe where it resyncs on any byte
+    if (keyframe->position >= 0 && resyncsOnBytes(formatContext->iformat)) {
+        return av_seek_frame(formatContext, -1, keyframe->position, AVSEEK_FLAG_BYTE) >= 0;
+    }
+
+    // Everywhere else the demuxer seeks through its own index, on the keyframe's exact timestamp
+    if (keyframe->pts == AV_NOPTS_VALUE) {
+        return false;
+    }
+
+    return av_seek_frame(formatContext, streamIndex, keyframe->pts, AVSEEK_FLAG_BACKWARD) >= 0;
+}
@@ -1,30 +1,82 @@
 #include "../include/ErrorHandler.hpp"
 
-#include <iostream>
-
 extern "C" {
 #include <libavutil/error.h>
 }
 
-ErrorHandler& ErrorHandler::getInstance() {
-    static ErrorHandler instance;
-    return instance;
+ErrorChannel::ErrorChannel(size_t capacity)
+    : slots(std::make_unique<Slot[]>(getSlotCount(capacity))), mask(getSlotCount(capacity) - 1), enqueuePosition(0), dequeuePosition(0), dropped(0) {
+    for (size_t i = 0; i <= mask; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool ErrorChannel::report(MediaPlayerException::ErrorCode code, std::string message) {
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+
+    while (true) {
+        Slot& slot = slots[position & mask];
+        size_t sequence = slot.sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if (difference == 0) {
+            // The slot is free, claim it against other producers
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.code = code;
+                slot.message = std::move(message);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            // The consumer has not taken the error a full lap ago yet
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            // Another producer claimed the slot first
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
 }
 
-void ErrorHandler::setErrorCallback(std::function<void(const MediaPlayerException&)> callback) {
-    errorCallback = std::move(callback);
+bool ErrorChannel::tryPop(MediaPlayerException::ErrorCode& code, std::string& message) {
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    Slot& slot = slots[position & mask];
+
+    if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+        return false;
+    }
+
+    code = slot.code;
+    message = std::move(slot.message);
+    slot.message = std::string();
+
+    // Hand the slot back to producers for the next lap
+    dequeuePosition.store(position + 1, std::memory_order_relaxed);
+    slot.sequence.store(position + mask + 1, std::memory_order_release);
+    return true;
 }
 
-void ErrorHandler::handleError(MediaPlayerException::ErrorCode code, const std::string& message) {
-    MediaPlayerException exception(code, message);
+void ErrorChannel::forwardTo(ErrorChannel& target) {
+    MediaPlayerException::ErrorCode code;
+    std::string message;
+
+    while (tryPop(code, message)) {
+        target.report(code, std::move(message));
+    }
+}
 
-    // Always log the error
-    std::cerr << "Error: " << message << std::endl;
+uint64_t ErrorChannel::getDroppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+}
 
-    // Call the callback if set
-    if (errorCallback) {
-        errorCallback(exception);
+size_t ErrorChannel::getSlotCount(size_t capacity) {
+    // A power of two maps positions to slots with a mask, two slots keep free and full apart
+    size_t count = 2;
+    while (count < capacity) {
+        count <<= 1;
     }
+
+    return count;
 }
 
 std::string ErrorHandler::ffmpegErrorToString(int errorCode) {
@@ -0,0 +1,208 @@
+#include "../include/FrameBufferPool.hpp"
+
+#include <sys/mman.h>
+
+#include <cstdlib>
+#include <utility>
+
+FrameBufferPool::Buffer::Buffer() : pool(nullptr), bufferData(nullptr), bufferSize(0), mapped(false) {
+}
+
+FrameBufferPool::Buffer::Buffer(FrameBufferPool* pool, uint8_t* data, size_t size, bool mapped)
+    : pool(pool), bufferData(data), bufferSize(size), mapped(mapped) {
+}
+
+FrameBufferPool::Buffer::~Buffer() {
+    release();
+}
+
+FrameBufferPool::Buffer::Buffer(Buffer&& other) noexcept
+    : pool(std::exchange(other.pool, nullptr)),
+      bufferData(std::exchange(other.bufferData, nullptr)),
+      bufferSize(std::exchange(other.bufferSize, 0)),
+      mapped(std::exchange(other.mapped, false)) {
+}
+
+FrameBufferPool::Buffer& FrameBufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = std::exchange(other.pool, nullptr);
+        bufferData = std::exchange(other.bufferData, nullptr);
+        bufferSize = std::exchange(other.bufferSize, 0);
+        mapped = std::exchange(other.mapped, false);
+    }
+
+    return *this;
+}
+
+void FrameBufferPool::Buffer::release() {
+    if (pool && bufferData) {
+        pool->recycle(bufferData, bufferSize, mapped);
+    }
+
+    pool = nullptr;
+    bufferData = nullptr;
+    bufferSize = 0;
+    mapped = false;
+}
+
+FrameBufferPool::FrameBufferPool(size_t maxFreeBuffers)
+    : maxFreeBuffers(maxFreeBuffers), bufferSize(0), hugePages(false), hits(0), misses(0), allocatedBytes(0) {
+}
+
+FrameBufferPool::~FrameBufferPool() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    for (const Block& block : freeBlocks) {
+        deallocate(block, bufferSize);
+    }
+
+    freeBlocks.clear();
+}
+
+void FrameBufferPool::setBufferSize(size_t size) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    // Round up to whole pages so every buffer starts and ends page aligned
+    size_t granularity = hugePages && size >= HUGE_PAGE_BYTES ? HUGE_PAGE_BYTES : BUFFER_ALIGNMENT;
+    size = (size + granularity - 1) / granularity * granularity;
+
+    if (size == bufferSize) {
+        return;
+    }
+
+    for (const Block& block : freeBlocks) {
+        deallocate(block, bufferSize);
+    }
+
+    freeBlocks.clear();
+    bufferSize = size;
+}
+
+size_t FrameBufferPool::getBufferSize() const {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    return bufferSize;
+}
+
+void FrameBufferPool::preallocate(size_t count) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    if (bufferSize == 0) {
+        return;
+    }
+
+    while (freeBlocks.size() < count && freeBlocks.size() < maxFreeBuffers) {
+        Block block = allocate(bufferSize);
+        if (!block.data) {
+            break;
+        }
+
+        freeBlocks.push_back(block);
+    }
+}
+
+void FrameBufferPool::setHugePages(bool enabled) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    hugePages = enabled;
+}
+
+FrameBufferPool::Buffer FrameBufferPool::acquire() {
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    if (bufferSize == 0) {
+        return Buffer();
+    }
+
+    // Reuse a recycled buffer if there is one
+    if (!freeBlocks.empty()) {
+        Block block = freeBlocks.back();
+        freeBlocks.pop_back();
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return Buffer(this, block.data, bufferSize, block.mapped);
+    }
+
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    Block block = allocate(bufferSize);
+    if (!block.data) {
+        return Buffer();
+    }
+
+    return Buffer(this, block.data, bufferSize, block.mapped);
+}
+
+FrameBufferPool::Stats FrameBufferPool::getStats() const {
+    Stats stats;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void FrameBufferPool::recycle(uint8_t* data, size_t size, bool mapped) {
+    std::lock_guard<std::mutex> lock(poolMutex);
+
+    Block block = {data, mapped};
+
+    // Drop buffers of an old size or beyond what the pool keeps around
+    if (size != bufferSize || freeBlocks.size() >= maxFreeBuffers) {
+        deallocate(block, size);
+        return;
+    }
+
+    freeBlocks.push_back(block);
+}
+
+FrameBufferPool::Block FrameBufferPool::allocate(size_t size) {
+    Block block = {nullptr, false};
+
+    if (hugePages && size >= HUGE_PAGE_BYTES) {
+        void* data = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+        // Explicit huge pages, only available if the system reserved some
+        data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+        if (data == MAP_FAILED) {
+            data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+#ifdef MADV_HUGEPAGE
+            // Fall back to transparent huge pages
+            if (data != MAP_FAILED) {
+                madvise(data, size, MADV_HUGEPAGE);
+            }
+#endif
+        }
+
+        if (data != MAP_FAILED) {
+            block.data = static_cast<uint8_t*>(data);
+            block.mapped = true;
+        }
+    } else {
+        void* data = nullptr;
+        if (posix_memalign(&data, BUFFER_ALIGNMENT, size) == 0) {
+            block.data = static_cast<uint8_t*>(data);
+        }
+    }
+
+    if (block.data) {
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    return block;
+}
+
+void FrameBufferPool::deallocate(const Block& block, size_t size) {
+    if (!block.data) {
+        return;
+    }
+
+    if (block.mapped) {
+        munmap(block.data, size);
+    } else {
+        free(block.data);
+    }
+
+    allocatedBytes.fetch_sub(size, std::memory_order_relaxed);
+}
@@ -0,0 +1,75 @@
+#include "../include/LatencyHistogram.hpp"
+
+#include <algorithm>
+
+#ifdef STAGE_HISTOGRAMS
+
+LatencyHistogram::LatencyHistogram() : maxValue(0) {
+    reset();
+}
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const {
+    // Copy the counts once, so every percentile is taken from the same total
+    std::array<uint64_t, BUCKET_COUNT> counts;
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    Summary summary{total, 0.0, 0.0, 0.0, 0.0};
+    if (total == 0) {
+        return summary;
+    }
+
+    // The exact maximum also caps the bucket limits of the highest percentiles
+    uint64_t maxNanoseconds = maxValue.load(std::memory_order_relaxed);
+    summary.max = maxNanoseconds / 1e9;
+
+    const double fractions[] = {0.5, 0.99, 0.999};
+    double* results[] = {&summary.p50, &summary.p99, &summary.p999};
+
+    for (size_t p = 0; p < 3; ++p) {
+        // Rank of the percentile among all recorded latencies, counted from 1
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fractions[p] * total + 0.5));
+        uint64_t seen = 0;
+
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                *results[p] = std::min(getBucketLimit(i), maxNanoseconds) / 1e9;
+                break;
+            }
+        }
+    }
+
+    return summary;
+}
+
+void LatencyHistogram::reset() {
+    for (std::atomic<uint64_t>& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getBucketLimit(size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+
+    if (bucket == BUCKET_COUNT - 1) {
+        return UINT64_MAX;
+    }
+
+    int exponent = static_cast<int>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    uint64_t subBucket = bucket % SUB_BUCKETS;
+    int shift = exponent - SUB_BUCKET_BITS;
+
+    // The sub-bucket covers 2^shift values starting at the highest bit plus its sub-bucket bits
+    return ((SUB_BUCKETS + subBucket) << shift) + (uint64_t(1) << shift) - 1;
+}
+
+#endif
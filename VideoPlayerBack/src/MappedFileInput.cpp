@@ -0,0 +1,115 @@
+#include "../include/MappedFileInput.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+MappedFileInput::MappedFileInput() : data(nullptr), fileSize(0), position(0), sequential(true), sequentialStart(0) {
+}
+
+MappedFileInput::~MappedFileInput() {
+    close();
+}
+
+bool MappedFileInput::openFile(const std::string& filename) {
+    int descriptor = ::open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || info.st_size <= 0) {
+        ::close(descriptor);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    data = static_cast<const uint8_t*>(mapping);
+    fileSize = static_cast<size_t>(info.st_size);
+    position = 0;
+    sequentialStart = 0;
+    advise(true);
+
+    return true;
+}
+
+void MappedFileInput::closeFile() {
+    if (data) {
+        munmap(const_cast<uint8_t*>(data), fileSize);
+        data = nullptr;
+    }
+
+    fileSize = 0;
+    position = 0;
+}
+
+int MappedFileInput::read(uint8_t* buffer, int size) {
+    if (position >= fileSize) {
+        return AVERROR_EOF;
+    }
+
+    size_t count = std::min(static_cast<size_t>(size), fileSize - position);
+    std::memcpy(buffer, data + position, count);
+    position += count;
+
+    // Reading has continued in order long enough after a seek, let the kernel read ahead again
+    if (!sequential && position - sequentialStart >= SEQUENTIAL_THRESHOLD) {
+        advise(true);
+    }
+
+    return static_cast<int>(count);
+}
+
+int64_t MappedFileInput::seek(int64_t offset, int whence) {
+    if (whence & AVSEEK_SIZE) {
+        return static_cast<int64_t>(fileSize);
+    }
+
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = static_cast<int64_t>(position) + offset;
+            break;
+        case SEEK_END:
+            target = static_cast<int64_t>(fileSize) + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+
+    if (target < 0 || target > static_cast<int64_t>(fileSize)) {
+        return AVERROR(EINVAL);
+    }
+
+    // A real jump makes read-ahead of the old position useless until reading settles again
+    size_t newPosition = static_cast<size_t>(target);
+    if (newPosition < position || newPosition - position > SHORT_SEEK_DISTANCE) {
+        sequentialStart = newPosition;
+        if (sequential) {
+            advise(false);
+        }
+    }
+
+    position = newPosition;
+    return target;
+}
+
+void MappedFileInput::advise(bool sequential) {
+    madvise(const_cast<uint8_t*>(data), fileSize, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    this->sequential = sequential;
+}
@@ -1,8 +1,19 @@
 #include "../include/MediaDecoder.hpp"
 
+#include <ctime>
 #include <iostream>
 
-MediaDecoder::MediaDecoder() : formatContext(nullptr), opened(false) {
+MediaDecoder::MediaDecoder()
+    : opened(false),
+      endOfStream(false),
+      endOfStreamEpoch(0),
+      decodedCount(0),
+      stepsEnabled(false),
+      stepQueued(false),
+      wakeRequested(false),
+      stepCount(0),
+      stepNanoseconds(0),
+      stepCpuNanoseconds(0) {
 }
 
 MediaDecoder::~MediaDecoder() {
@@ -10,104 +21,240 @@ MediaDecoder::~MediaDecoder() {
 }
 
 bool MediaDecoder::open(const std::string& filename) {
-    std::lock_guard<std::mutex> lock(mutex);
-
-    // Close any previously opened file
-    if (opened) {
-        close();
+    auto privateDemuxer = std::make_shared<Demuxer>();
+    if (!privateDemuxer->open(filename)) {
+        return false;
     }
 
     this->filename = filename;
+    return open(std::move(privateDemuxer));
+}
 
-    // Open the input file
-    formatContext = avformat_alloc_context();
-    if (!formatContext) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to allocate format context");
-        return false;
+bool MediaDecoder::open(std::shared_ptr<Demuxer> demuxer) {
+    // Close any previously opened file
+    if (opened) {
+        close();
     }
 
-    // Open input file
-    int result = avformat_open_input(&formatContext, filename.c_str(), nullptr, nullptr);
-    if (result < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::FILE_NOT_FOUND,
-                                                "Could not open file: " + filename + " - " + ErrorHandler::ffmpegErrorToString(result));
-        avformat_free_context(formatContext);
-        formatContext = nullptr;
-        return false;
-    }
+    std::lock_guard<std::mutex> lock(mutex);
 
-    // Find stream info
-    result = avformat_find_stream_info(formatContext, nullptr);
-    if (result < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::FORMAT_ERROR,
-                                                "Could not find stream information: " + ErrorHandler::ffmpegErrorToString(result));
-        avformat_close_input(&formatContext);
-        formatContext = nullptr;
+    if (!demuxer || !demuxer->isOpen()) {
         return false;
     }
 
+    this->demuxer = std::move(demuxer);
     opened = true;
+    endOfStream = false;
+    stepCount = 0;
+    stepNanoseconds = 0;
+    stepCpuNanoseconds = 0;
+    decodedCount = 0;
     return true;
 }
 
 void MediaDecoder::close() {
     std::lock_guard<std::mutex> lock(mutex);
 
-    if (formatContext) {
-        avformat_close_input(&formatContext);
-        formatContext = nullptr;
-    }
-
+    demuxer.reset();
     opened = false;
 }
 
-bool MediaDecoder::seek(double seconds) {
+bool MediaDecoder::seek(double seconds, bool exact) {
     std::lock_guard<std::mutex> lock(mutex);
 
-    if (!opened || !formatContext) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Cannot seek: no file is open");
+    if (!opened || !demuxer) {
+        errors.report(MediaPlayerException::DECODER_ERROR, "Cannot seek: no file is open");
         return false;
     }
 
-    // Convert seconds to timestamp
-    int64_t timestamp = static_cast<int64_t>(seconds * AV_TIME_BASE);
+    return demuxer->seek(seconds, exact);
+}
 
-    // Seek to the timestamp
-    int result = av_seek_frame(formatContext, -1, timestamp, AVSEEK_FLAG_BACKWARD);
-    if (result < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Seek failed: " + ErrorHandler::ffmpegErrorToString(result));
+bool MediaDecoder::enterEpoch(EpochState& state, uint64_t packetEpoch, AVCodecContext* context) {
+    if (isStaleEpoch(packetEpoch)) {
         return false;
     }
 
+    if (packetEpoch != state.epoch) {
+        // First packet after a seek, whatever the codec still buffers belongs to the old position
+        avcodec_flush_buffers(context);
+        endOfStream = false;
+        state.epoch = packetEpoch;
+        state.seekTarget = demuxer->getSeekTarget(packetEpoch);
+    }
+
     return true;
 }
 
-double MediaDecoder::getDuration() const {
-    if (!opened || !formatContext) {
-        return 0.0;
+bool MediaDecoder::isStaleEpoch(uint64_t epoch) const {
+    return demuxer && epoch < demuxer->getSeekEpoch();
+}
+
+bool MediaDecoder::skipBeforeSeekTarget(EpochState& state, double endPts) {
+    if (state.seekTarget < 0.0) {
+        return false;
+    }
+
+    if (endPts <= state.seekTarget) {
+        return true;
     }
 
-    if (formatContext->duration == AV_NOPTS_VALUE) {
+    state.seekTarget = -1.0;
+    return false;
+}
+
+double MediaDecoder::getDuration() const {
+    if (!opened || !demuxer) {
         return 0.0;
     }
 
-    return static_cast<double>(formatContext->duration) / AV_TIME_BASE;
+    return demuxer->getDuration();
 }
 
 bool MediaDecoder::isOpen() const {
     return opened;
 }
 
+bool MediaDecoder::isEndOfStream() const {
+    return endOfStream && !isStaleEpoch(endOfStreamEpoch);
+}
+
+bool MediaDecoder::isEndOfStreamPacket(const AVPacket* packet) {
+    return !packet->data && packet->size == 0;
+}
+
+void MediaDecoder::setEndOfStream(const EpochState& state) {
+    // The epoch is stored first, a reader seeing the flag also sees its epoch
+    endOfStreamEpoch = state.epoch;
+    endOfStream = true;
+}
+
 int MediaDecoder::findStream(AVMediaType type) const {
-    if (!opened || !formatContext) {
+    if (!opened || !demuxer) {
         return -1;
     }
 
-    for (unsigned int i = 0; i < formatContext->nb_streams; ++i) {
-        if (formatContext->streams[i]->codecpar->codec_type == type) {
-            return i;
+    return demuxer->findStream(type);
+}
+
+void MediaDecoder::setThreading(const DecoderThreading& threading) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->threading = threading;
+}
+
+DecoderThreading MediaDecoder::getThreading() const {
+    return threading;
+}
+
+ErrorChannel& MediaDecoder::getErrorChannel() {
+    return errors;
+}
+
+MediaDecoder::StepStats MediaDecoder::getStepStats() const {
+    return StepStats{stepCount.load(std::memory_order_relaxed), stepNanoseconds.load(std::memory_order_relaxed) / 1e9,
+                     stepCpuNanoseconds.load(std::memory_order_relaxed) / 1e9, decodedCount.load(std::memory_order_relaxed)};
+}
+
+void MediaDecoder::requestDecode() {
+    std::lock_guard<std::mutex> lock(stepMutex);
+    wakeRequested = true;
+
+    // A queued or running step picks the work up
+    if (stepsEnabled && !stepQueued) {
+        stepQueued = true;
+        submitStep();
+    }
+}
+
+void MediaDecoder::startSteps() {
+    {
+        std::lock_guard<std::mutex> lock(stepMutex);
+        stepsEnabled = true;
+    }
+
+    requestDecode();
+}
+
+void MediaDecoder::stopSteps() {
+    std::unique_lock<std::mutex> lock(stepMutex);
+    stepsEnabled = false;
+
+    // A queued step returns as soon as it runs, a running one after its current step
+    stepCondition.wait(lock, [this] { return !stepQueued; });
+}
+
+void MediaDecoder::submitStep() {
+    auto deadline = DecodeExecutor::Clock::now() + std::chrono::duration_cast<DecodeExecutor::Clock::duration>(
+                                                        std::chrono::duration<double>(getQueuedSeconds()));
+    DecodeExecutor::getShared().submit(deadline, [this] { runStep(); });
+}
+
+void MediaDecoder::runStep() {
+    std::unique_lock<std::mutex> lock(stepMutex);
+
+    while (stepsEnabled) {
+        wakeRequested = false;
+
+        lock.unlock();
+        auto stepStart = std::chrono::steady_clock::now();
+        uint64_t cpuStart = getThreadCpuNanoseconds();
+        bool budgetUsed = decodeStep();
+        stepNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - stepStart).count(),
+                                  std::memory_order_relaxed);
+        stepCpuNanoseconds.fetch_add(getThreadCpuNanoseconds() - cpuStart, std::memory_order_relaxed);
+        stepCount.fetch_add(1, std::memory_order_relaxed);
+        lock.lock();
+
+        // Steps of other decoders with earlier deadlines go first
+        if (budgetUsed && stepsEnabled) {
+            submitStep();
+            return;
         }
+
+        // Nothing to do until requestDecode(), unless it was called during the step
+        if (!wakeRequested) {
+            break;
+        }
+    }
+
+    stepQueued = false;
+    stepCondition.notify_all();
+}
+
+uint64_t MediaDecoder::getThreadCpuNanoseconds() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0) {
+        return static_cast<uint64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+#endif
+    return 0;
+}
+
+void MediaDecoder::applyThreading(AVCodecContext* context, const AVCodec* codec) const {
+    context->thread_count = threading.threadCount > 0 ? threading.threadCount : 0;
+
+    // Only request the threading kinds the codec supports
+    int threadType = 0;
+    if (threading.type != DecoderThreading::SLICE && (codec->capabilities & AV_CODEC_CAP_FRAME_THREADS)) {
+        threadType |= FF_THREAD_FRAME;
+    }
+    if (threading.type != DecoderThreading::FRAME && (codec->capabilities & AV_CODEC_CAP_SLICE_THREADS)) {
+        threadType |= FF_THREAD_SLICE;
+    }
+
+    context->thread_type = threadType;
+}
+
+int MediaDecoder::activeThreadCount(const AVCodecContext* context) {
+    if (!context) {
+        return 0;
+    }
+
+    // Codec runs on the calling thread when no threading kind became active
+    if (!context->active_thread_type) {
+        return 1;
     }
 
-    return -1;
+    return context->thread_count;
 }
@@ -0,0 +1,96 @@
+#include "../include/MediaInput.hpp"
+
+#include <chrono>
+
+MediaInput::MediaInput() : context(nullptr), reads(0), bytesRead(0), stalls(0), stallTimeNs(0), maxStallNs(0) {
+}
+
+MediaInput::~MediaInput() {
+    // Subclasses close their file in their own destructor, only the context is left here
+    if (context) {
+        av_freep(&context->buffer);
+        avio_context_free(&context);
+    }
+}
+
+bool MediaInput::open(const std::string& filename) {
+    close();
+
+    if (!openFile(filename)) {
+        return false;
+    }
+
+    reads.store(0, std::memory_order_relaxed);
+    bytesRead.store(0, std::memory_order_relaxed);
+    stalls.store(0, std::memory_order_relaxed);
+    stallTimeNs.store(0, std::memory_order_relaxed);
+    maxStallNs.store(0, std::memory_order_relaxed);
+
+    unsigned char* buffer = static_cast<unsigned char*>(av_malloc(BUFFER_SIZE));
+    if (!buffer) {
+        closeFile();
+        return false;
+    }
+
+    context = avio_alloc_context(buffer, BUFFER_SIZE, 0, this, &MediaInput::readPacket, nullptr, &MediaInput::seekPacket);
+    if (!context) {
+        av_free(buffer);
+        closeFile();
+        return false;
+    }
+
+    return true;
+}
+
+void MediaInput::close() {
+    if (!context) {
+        return;
+    }
+
+    // FFmpeg may have replaced the buffer, free whatever the context holds now
+    av_freep(&context->buffer);
+    avio_context_free(&context);
+    closeFile();
+}
+
+AVIOContext* MediaInput::getContext() const {
+    return context;
+}
+
+MediaInput::Stats MediaInput::getStats() const {
+    Stats stats;
+    stats.reads = reads.load(std::memory_order_relaxed);
+    stats.bytesRead = bytesRead.load(std::memory_order_relaxed);
+    stats.stalls = stalls.load(std::memory_order_relaxed);
+    stats.stallTime = stallTimeNs.load(std::memory_order_relaxed) / 1e9;
+    stats.maxStall = maxStallNs.load(std::memory_order_relaxed) / 1e9;
+    return stats;
+}
+
+int MediaInput::readPacket(void* opaque, uint8_t* buffer, int size) {
+    MediaInput* input = static_cast<MediaInput*>(opaque);
+
+    // Time every read, slow ones are what drains the decoder queues
+    auto start = std::chrono::steady_clock::now();
+    int result = input->read(buffer, size);
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    input->reads.fetch_add(1, std::memory_order_relaxed);
+    if (result > 0) {
+        input->bytesRead.fetch_add(static_cast<uint64_t>(result), std::memory_order_relaxed);
+    }
+
+    if (elapsed >= STALL_THRESHOLD_NS) {
+        input->stalls.fetch_add(1, std::memory_order_relaxed);
+        input->stallTimeNs.fetch_add(elapsed, std::memory_order_relaxed);
+        if (elapsed > input->maxStallNs.load(std::memory_order_relaxed)) {
+            input->maxStallNs.store(elapsed, std::memory_order_relaxed);
+        }
+    }
+
+    return result;
+}
+
+int64_t MediaInput::seekPacket(void* opaque, int64_t offset, int whence) {
+    return static_cast<MediaInput*>(opaque)->seek(offset, whence);
+}
@@ -0,0 +1,351 @@
+#include "../include/PacketIndex.hpp"
+
+#include "../include/CacheFiles.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t pathHash;
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    uint32_t streamCount;
+    uint32_t reserved;
+};
+
+struct StreamHeader {
+    int32_t streamIndex;
+    int32_t timeBaseNum;
+    int32_t timeBaseDen;
+    uint32_t reserved;
+    double frameDuration;
+    int64_t frameCount;
+    uint64_t entryCount;
+};
+
+// Keyframes closer together than this share one entry, keeps audio and intra-only streams small
+constexpr double MIN_ENTRY_INTERVAL = 0.5;
+
+}  // namespace
+
+bool PacketIndex::build(const std::string& filename, const std::atomic<bool>& abort, MediaInput* input) {
+    streams.clear();
+
+    // Use a private context so building does not disturb playback
+    AVFormatContext* context = avformat_alloc_context();
+    if (!context) {
+        return false;
+    }
+
+    if (input) {
+        context->pb = input->getContext();
+    }
+
+    // Frees the context on failure
+    if (avformat_open_input(&context, filename.c_str(), nullptr, nullptr) < 0) {
+        return false;
+    }
+
+    AVPacket* packet = av_packet_alloc();
+    if (!packet) {
+        avformat_close_input(&context);
+        return false;
+    }
+
+    std::vector<StreamEntries> entries;
+    std::vector<int64_t> firstPts;
+    std::vector<int64_t> lastPts;
+    bool complete = false;
+
+    // Only packet headers are needed, nothing is decoded
+    while (!abort) {
+        int result = av_read_frame(context, packet);
+        if (result == AVERROR_EOF) {
+            complete = true;
+            break;
+        }
+
+        if (result < 0) {
+            break;
+        }
+
+        // Streams can appear while reading
+        size_t index = static_cast<size_t>(packet->stream_index);
+        if (index >= entries.size()) {
+            entries.resize(index + 1, StreamEntries{0, AVRational{0, 1}, 0.0, 0, {}});
+            firstPts.resize(index + 1, AV_NOPTS_VALUE);
+            lastPts.resize(index + 1, AV_NOPTS_VALUE);
+        }
+
+        StreamEntries& stream = entries[index];
+        int64_t pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+
+        if (pts != AV_NOPTS_VALUE) {
+            if (firstPts[index] == AV_NOPTS_VALUE) {
+                firstPts[index] = pts;
+            }
+            lastPts[index] = std::max(lastPts[index], pts);
+
+            if (packet->flags & AV_PKT_FLAG_KEY) {
+                double interval = 0.0;
+                if (!stream.keyframes.empty()) {
+                    interval = (pts - stream.keyframes.back().pts) * av_q2d(context->streams[index]->time_base);
+                }
+
+                if (stream.keyframes.empty() || interval >= MIN_ENTRY_INTERVAL || interval < 0.0) {
+                    stream.keyframes.push_back({pts, packet->pos, stream.frameCount});
+                }
+            }
+        }
+
+        ++stream.frameCount;
+        av_packet_unref(packet);
+    }
+
+    if (complete) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            StreamEntries& stream = entries[i];
+            AVStream* avStream = context->streams[i];
+
+            stream.streamIndex = static_cast<int>(i);
+            stream.timeBase = avStream->time_base;
+
+            // Prefer the declared frame rate, otherwise average over the stream
+            if (avStream->avg_frame_rate.num > 0 && avStream->avg_frame_rate.den > 0) {
+                stream.frameDuration = av_q2d(av_inv_q(avStream->avg_frame_rate));
+            } else if (stream.frameCount > 1 && firstPts[i] != AV_NOPTS_VALUE) {
+                stream.frameDuration = (lastPts[i] - firstPts[i]) * av_q2d(stream.timeBase) / (stream.frameCount - 1);
+            }
+
+            std::stable_sort(stream.keyframes.begin(), stream.keyframes.end(), [](const Entry& a, const Entry& b) { return a.pts < b.pts; });
+        }
+
+        streams = std::move(entries);
+    }
+
+    av_packet_free(&packet);
+    avformat_close_input(&context);
+
+    return complete;
+}
+
+bool PacketIndex::load(const std::string& filename) {
+    streams.clear();
+
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    if (!CacheFiles::getFileStamp(filename, fileSize, modifiedTime)) {
+        return false;
+    }
+
+    uint64_t pathHash = CacheFiles::getPathHash(filename);
+    std::string directory = CacheFiles::getDirectory("index");
+    std::ifstream file((std::filesystem::path(directory) / getCacheName(pathHash, fileSize, modifiedTime)).string(), std::ios::binary);
+    if (!file) {
+        return false;
+    }
+
+    // An index of another version or another file is ignored and rebuilt
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION || header.pathHash != pathHash || header.fileSize != fileSize || header.modifiedTime != modifiedTime) {
+        return false;
+    }
+
+    std::vector<StreamEntries> entries(header.streamCount);
+    for (StreamEntries& stream : entries) {
+        StreamHeader streamHeader;
+        if (!file.read(reinterpret_cast<char*>(&streamHeader), sizeof(streamHeader)) || streamHeader.timeBaseDen <= 0) {
+            return false;
+        }
+
+        // Reject counts the file cannot possibly hold before allocating for them
+        if (streamHeader.entryCount > fileSize / sizeof(Entry) + 1) {
+            return false;
+        }
+
+        stream.streamIndex = streamHeader.streamIndex;
+        stream.timeBase = AVRational{streamHeader.timeBaseNum, streamHeader.timeBaseDen};
+        stream.frameDuration = streamHeader.frameDuration;
+        stream.frameCount = streamHeader.frameCount;
+        stream.keyframes.resize(streamHeader.entryCount);
+
+        if (!file.read(reinterpret_cast<char*>(stream.keyframes.data()), stream.keyframes.size() * sizeof(Entry))) {
+            return false;
+        }
+    }
+
+    streams = std::move(entries);
+    return true;
+}
+
+bool PacketIndex::save(const std::string& filename) const {
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    if (!CacheFiles::getFileStamp(filename, fileSize, modifiedTime)) {
+        return false;
+    }
+
+    uint64_t pathHash = CacheFiles::getPathHash(filename);
+    std::filesystem::path directory = CacheFiles::getDirectory("index");
+    std::string name = getCacheName(pathHash, fileSize, modifiedTime);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    // Write to a uniquely named temporary file and rename it, readers never see a partial index and
+    // other processes saving the same index do not interfere
+    std::string path = (directory / name).string();
+    std::string temporaryPath = path + ".XXXXXX";
+
+    int descriptor = mkstemp(&temporaryPath[0]);
+    if (descriptor < 0) {
+        return false;
+    }
+    ::close(descriptor);
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+
+        FileHeader header = {};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.pathHash = pathHash;
+        header.fileSize = fileSize;
+        header.modifiedTime = modifiedTime;
+        header.streamCount = static_cast<uint32_t>(streams.size());
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (const StreamEntries& stream : streams) {
+            StreamHeader streamHeader = {};
+            streamHeader.streamIndex = stream.streamIndex;
+            streamHeader.timeBaseNum = stream.timeBase.num;
+            streamHeader.timeBaseDen = stream.timeBase.den;
+            streamHeader.frameDuration = stream.frameDuration;
+            streamHeader.frameCount = stream.frameCount;
+            streamHeader.entryCount = stream.keyframes.size();
+
+            file.write(reinterpret_cast<const char*>(&streamHeader), sizeof(streamHeader));
+            file.write(reinterpret_cast<const char*>(stream.keyframes.data()), stream.keyframes.size() * sizeof(Entry));
+        }
+
+        if (!file.flush()) {
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    // Indexes of earlier versions of the same file are never read again
+    std::string prefix = name.substr(0, name.find('-') + 1);
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        std::string entry = it->path().filename().string();
+        if (entry != name && entry.compare(0, prefix.size(), prefix) == 0 && it->path().extension() == EXTENSION) {
+            std::error_code removeError;
+            std::filesystem::remove(it->path(), removeError);
+        }
+    }
+
+    return true;
+}
+
+std::string PacketIndex::getCachePath(const std::string& filename) {
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    if (!CacheFiles::getFileStamp(filename, fileSize, modifiedTime)) {
+        return std::string();
+    }
+
+    std::filesystem::path directory = CacheFiles::getDirectory("index");
+    return (directory / getCacheName(CacheFiles::getPathHash(filename), fileSize, modifiedTime)).string();
+}
+
+std::string PacketIndex::getCacheName(uint64_t pathHash, uint64_t fileSize, int64_t modifiedTime) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%016llx-%llx-%llx", static_cast<unsigned long long>(pathHash), static_cast<unsigned long long>(fileSize),
+                  static_cast<unsigned long long>(modifiedTime));
+    return std::string(name) + EXTENSION;
+}
+
+bool PacketIndex::hasStream(int streamIndex) const {
+    const StreamEntries* stream = findStream(streamIndex);
+    return stream && !stream->keyframes.empty();
+}
+
+const PacketIndex::Entry* PacketIndex::findKeyframe(int streamIndex, double seconds) const {
+    const StreamEntries* stream = findStream(streamIndex);
+    if (!stream || stream->keyframes.empty()) {
+        return nullptr;
+    }
+
+    int64_t target = static_cast<int64_t>(std::floor(seconds / av_q2d(stream->timeBase)));
+
+    // Binary search for the first keyframe after the target, the one before it is the answer
+    auto it = std::upper_bound(stream->keyframes.begin(), stream->keyframes.end(), target,
+                               [](int64_t pts, const Entry& entry) { return pts < entry.pts; });
+    if (it == stream->keyframes.begin()) {
+        return nullptr;
+    }
+
+    return &*(it - 1);
+}
+
+int64_t PacketIndex::getFrameNumber(int streamIndex, double seconds) const {
+    const StreamEntries* stream = findStream(streamIndex);
+    const Entry* keyframe = findKeyframe(streamIndex, seconds);
+    if (!keyframe) {
+        return 0;
+    }
+
+    // Count frames from the keyframe at the stream's frame rate
+    double offset = seconds - keyframe->pts * av_q2d(stream->timeBase);
+    int64_t frames = stream->frameDuration > 0.0 ? static_cast<int64_t>(offset / stream->frameDuration + 1e-6) : 0;
+
+    return std::min(keyframe->frameNumber + frames, std::max<int64_t>(stream->frameCount - 1, 0));
+}
+
+double PacketIndex::getFrameTimestamp(int streamIndex, int64_t frameNumber) const {
+    const StreamEntries* stream = findStream(streamIndex);
+    if (!stream || stream->keyframes.empty()) {
+        return 0.0;
+    }
+
+    // Last keyframe at or before the frame, keyframes are in decode order so frame numbers ascend
+    auto it = std::upper_bound(stream->keyframes.begin(), stream->keyframes.end(), frameNumber,
+                               [](int64_t number, const Entry& entry) { return number < entry.frameNumber; });
+    if (it != stream->keyframes.begin()) {
+        --it;
+    }
+
+    return it->pts * av_q2d(stream->timeBase) + (frameNumber - it->frameNumber) * stream->frameDuration;
+}
+
+const PacketIndex::StreamEntries* PacketIndex::findStream(int streamIndex) const {
+    for (const StreamEntries& stream : streams) {
+        if (stream.streamIndex == streamIndex) {
+            return &stream;
+        }
+    }
+
+    return nullptr;
+}
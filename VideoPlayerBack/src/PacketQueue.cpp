@@ -0,0 +1,151 @@
+#include "../include/PacketQueue.hpp"
+
+#include <algorithm>
+
+PacketQueue::PacketQueue() : ring(INITIAL_CAPACITY), head(0), count(0), hits(0), misses(0), bytes(0), currentEpoch(0) {
+    // Reserve the free list once so recycling never grows it
+    freePackets.reserve(MAX_FREE_PACKETS);
+}
+
+PacketQueue::~PacketQueue() {
+    flush();
+
+    for (AVPacket* packet : freePackets) {
+        av_packet_free(&packet);
+    }
+}
+
+bool PacketQueue::push(AVPacket* packet, uint64_t epoch) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+
+        // Read before a seek that has flushed the queue since
+        if (epoch < currentEpoch) {
+            return false;
+        }
+
+        AVPacket* queued = acquirePacketLocked();
+        if (!queued) {
+            return false;
+        }
+
+        // Grow the ring in order when it is full, it never shrinks again
+        if (count == ring.size()) {
+            std::vector<QueuedPacket> grown(ring.size() * 2);
+            for (size_t i = 0; i < count; ++i) {
+                grown[i] = ring[(head + i) % ring.size()];
+            }
+
+            ring.swap(grown);
+            head = 0;
+        }
+
+        av_packet_move_ref(queued, packet);
+        bytes += queued->size;
+        ring[(head + count) % ring.size()] = {queued, epoch};
+        ++count;
+
+        if (pushCallback) {
+            pushCallback();
+        }
+    }
+
+    // Wake up the consumer
+    queueCondition.notify_one();
+
+    return true;
+}
+
+bool PacketQueue::pop(AVPacket* packet, uint64_t& epoch, std::chrono::milliseconds timeout) {
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (!queueCondition.wait_for(lock, timeout, [this] { return count > 0; })) {
+            return false;
+        }
+
+        AVPacket* queued = ring[head].packet;
+        epoch = ring[head].epoch;
+        head = (head + 1) % ring.size();
+        --count;
+        bytes -= queued->size;
+
+        // Moving the reference out is a copy of the struct, the emptied packet goes straight back to the pool
+        av_packet_move_ref(packet, queued);
+        releasePacketLocked(queued);
+    }
+
+    // Notify producer that space is available
+    if (popCallback) {
+        popCallback();
+    }
+
+    return true;
+}
+
+void PacketQueue::flush() {
+    flush(0);
+}
+
+void PacketQueue::flush(uint64_t epoch) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    currentEpoch = std::max(currentEpoch, epoch);
+
+    for (; count > 0; --count) {
+        releasePacketLocked(ring[head].packet);
+        head = (head + 1) % ring.size();
+    }
+
+    head = 0;
+    bytes = 0;
+}
+
+size_t PacketQueue::size() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return count;
+}
+
+size_t PacketQueue::byteSize() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return bytes;
+}
+
+PacketQueue::PoolStats PacketQueue::getPoolStats() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    PoolStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    return stats;
+}
+
+void PacketQueue::setPopCallback(std::function<void()> callback) {
+    popCallback = std::move(callback);
+}
+
+void PacketQueue::setPushCallback(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    pushCallback = std::move(callback);
+}
+
+AVPacket* PacketQueue::acquirePacketLocked() {
+    if (freePackets.empty()) {
+        ++misses;
+        return av_packet_alloc();
+    }
+
+    AVPacket* packet = freePackets.back();
+    freePackets.pop_back();
+    ++hits;
+    return packet;
+}
+
+void PacketQueue::releasePacketLocked(AVPacket* packet) {
+    av_packet_unref(packet);
+
+    if (freePackets.size() < MAX_FREE_PACKETS) {
+        freePackets.push_back(packet);
+    } else {
+        av_packet_free(&packet);
+    }
+}
@@ -0,0 +1,201 @@
+#include "../include/PrefetchInput.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+PrefetchInput::PrefetchInput(size_t windowSize)
+    : descriptor(-1),
+      fileSize(0),
+      capacity(std::min(std::max(windowSize, MIN_WINDOW_SIZE), MAX_WINDOW_SIZE) + KEEP_BEHIND),
+      windowHead(0),
+      windowLength(0),
+      windowStart(0),
+      position(0),
+      generation(0),
+      endOfFile(false),
+      readError(0),
+      stopping(false) {
+}
+
+PrefetchInput::~PrefetchInput() {
+    close();
+}
+
+bool PrefetchInput::openFile(const std::string& filename) {
+    descriptor = ::open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        ::close(descriptor);
+        descriptor = -1;
+        return false;
+    }
+
+    fileSize = static_cast<int64_t>(info.st_size);
+    window.resize(capacity);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        resetWindow(0);
+        stopping = false;
+    }
+
+    prefetchThread = std::thread(&PrefetchInput::prefetchLoop, this);
+    return true;
+}
+
+void PrefetchInput::closeFile() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    // Wake up both sides, a read already issued to storage still has to finish
+    spaceCondition.notify_all();
+    dataCondition.notify_all();
+
+    if (prefetchThread.joinable()) {
+        prefetchThread.join();
+    }
+
+    if (descriptor >= 0) {
+        ::close(descriptor);
+        descriptor = -1;
+    }
+
+    window.clear();
+    window.shrink_to_fit();
+}
+
+int PrefetchInput::read(uint8_t* buffer, int size) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Waiting here is the stall the window is sized to avoid
+    dataCondition.wait(lock, [this] {
+        return position < windowStart + static_cast<int64_t>(windowLength) || endOfFile || readError != 0 || stopping;
+    });
+
+    int64_t available = windowStart + static_cast<int64_t>(windowLength) - position;
+    if (available <= 0) {
+        return readError != 0 ? AVERROR(readError) : AVERROR_EOF;
+    }
+
+    // Copy out of the ring, wrapping around its end
+    size_t count = std::min(static_cast<size_t>(size), static_cast<size_t>(available));
+    size_t offset = (windowHead + static_cast<size_t>(position - windowStart)) % capacity;
+    size_t first = std::min(count, capacity - offset);
+
+    std::memcpy(buffer, window.data() + offset, first);
+    std::memcpy(buffer + first, window.data(), count - first);
+    position += static_cast<int64_t>(count);
+
+    // Hand what lies too far behind the read position back to the prefetch thread
+    size_t behind = static_cast<size_t>(position - windowStart);
+    if (behind > KEEP_BEHIND) {
+        size_t released = behind - KEEP_BEHIND;
+        windowHead = (windowHead + released) % capacity;
+        windowStart += static_cast<int64_t>(released);
+        windowLength -= released;
+        spaceCondition.notify_one();
+    }
+
+    return static_cast<int>(count);
+}
+
+int64_t PrefetchInput::seek(int64_t offset, int whence) {
+    if (whence & AVSEEK_SIZE) {
+        return fileSize;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    int64_t target;
+    switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = position + offset;
+            break;
+        case SEEK_END:
+            target = fileSize + offset;
+            break;
+        default:
+            return AVERROR(EINVAL);
+    }
+
+    if (target < 0 || target > fileSize) {
+        return AVERROR(EINVAL);
+    }
+
+    // Inside the window the prefetched bytes stay valid, anywhere else prefetching starts over
+    if (target >= windowStart && target <= windowStart + static_cast<int64_t>(windowLength)) {
+        position = target;
+    } else {
+        resetWindow(target);
+    }
+
+    return target;
+}
+
+void PrefetchInput::prefetchLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (!stopping) {
+        // Wait for room in the window, nothing is read past the end of the file or after an error
+        spaceCondition.wait(lock, [this] { return stopping || (windowLength < capacity && !endOfFile && readError == 0); });
+
+        if (stopping) {
+            break;
+        }
+
+        // Read into the free part of the ring after the window, the reader never touches it
+        size_t tail = (windowHead + windowLength) % capacity;
+        size_t count = std::min({CHUNK_SIZE, capacity - windowLength, capacity - tail});
+        int64_t offset = windowStart + static_cast<int64_t>(windowLength);
+        uint64_t readGeneration = generation;
+
+        lock.unlock();
+        ssize_t result = pread(descriptor, window.data() + tail, count, offset);
+        int error = result < 0 ? errno : 0;
+        lock.lock();
+
+        // A seek discarded the window while reading
+        if (readGeneration != generation) {
+            continue;
+        }
+
+        if (result < 0) {
+            if (error != EINTR) {
+                readError = error;
+            }
+        } else if (result == 0) {
+            endOfFile = true;
+        } else {
+            windowLength += static_cast<size_t>(result);
+        }
+
+        dataCondition.notify_all();
+    }
+}
+
+void PrefetchInput::resetWindow(int64_t offset) {
+    ++generation;
+    windowHead = 0;
+    windowLength = 0;
+    windowStart = offset;
+    position = offset;
+    endOfFile = false;
+    readError = 0;
+
+    spaceCondition.notify_one();
+}
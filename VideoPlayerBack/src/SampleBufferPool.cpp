@@ -0,0 +1,64 @@
+#include "../include/SampleBufferPool.hpp"
+
+SampleBufferPool::SampleBufferPool(size_t maxFreeBuffers)
+    : slots(std::make_unique<Slot[]>(maxFreeBuffers)), slotCount(maxFreeBuffers), hits(0), misses(0) {
+    for (size_t i = 0; i < slotCount; ++i) {
+        slots[i].state.store(EMPTY, std::memory_order_relaxed);
+    }
+}
+
+std::vector<sf::Int16> SampleBufferPool::acquire() {
+    Slot* slot = claim(FULL);
+    if (!slot) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::vector<sf::Int16>();
+    }
+
+    std::vector<sf::Int16> samples = std::move(slot->samples);
+    slot->state.store(EMPTY, std::memory_order_release);
+    hits.fetch_add(1, std::memory_order_relaxed);
+
+    return samples;
+}
+
+void SampleBufferPool::release(std::vector<sf::Int16>&& samples) {
+    if (samples.capacity() == 0) {
+        return;
+    }
+
+    Slot* slot = claim(EMPTY);
+    if (!slot) {
+        return;
+    }
+
+    samples.clear();
+    slot->samples = std::move(samples);
+    slot->state.store(FULL, std::memory_order_release);
+}
+
+void SampleBufferPool::clear() {
+    while (Slot* slot = claim(FULL)) {
+        slot->samples = std::vector<sf::Int16>();
+        slot->state.store(EMPTY, std::memory_order_release);
+    }
+}
+
+SampleBufferPool::Stats SampleBufferPool::getStats() const {
+    Stats stats;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    return stats;
+}
+
+SampleBufferPool::Slot* SampleBufferPool::claim(SlotState from) {
+    // The pool holds a handful of buffers, a scan is cheaper than any list that would need ABA protection
+    for (size_t i = 0; i < slotCount; ++i) {
+        int expected = from;
+        if (slots[i].state.load(std::memory_order_relaxed) == from &&
+            slots[i].state.compare_exchange_strong(expected, BUSY, std::memory_order_acquire, std::memory_order_relaxed)) {
+            return &slots[i];
+        }
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,315 @@
+#include "../include/ThumbnailCache.hpp"
+
+#include "../include/CacheFiles.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t pathHash;
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    double duration;
+    uint32_t count;
+    uint32_t readyCount;
+    uint32_t maxWidth;
+    uint32_t maxHeight;
+};
+
+struct TileEntry {
+    double pts;
+    uint64_t offset;  // From the start of the cache file
+    uint32_t width;
+    uint32_t height;
+};
+
+const FileHeader* getHeader(const uint8_t* data) {
+    return reinterpret_cast<const FileHeader*>(data);
+}
+
+const TileEntry* getEntries(const uint8_t* data) {
+    return reinterpret_cast<const TileEntry*>(data + sizeof(FileHeader));
+}
+
+}  // namespace
+
+ThumbnailCache::Strip::Strip() : data(nullptr), length(0) {
+}
+
+ThumbnailCache::Strip::~Strip() {
+    close();
+}
+
+void ThumbnailCache::Strip::close() {
+    if (data) {
+        munmap(const_cast<uint8_t*>(data), length);
+        data = nullptr;
+    }
+
+    length = 0;
+}
+
+bool ThumbnailCache::Strip::isOpen() const {
+    return data != nullptr;
+}
+
+size_t ThumbnailCache::Strip::getCount() const {
+    return data ? getHeader(data)->count : 0;
+}
+
+size_t ThumbnailCache::Strip::getReadyCount() const {
+    return data ? getHeader(data)->readyCount : 0;
+}
+
+double ThumbnailCache::Strip::getDuration() const {
+    return data ? getHeader(data)->duration : 0.0;
+}
+
+bool ThumbnailCache::Strip::getTile(size_t index, Tile& tile) const {
+    if (index >= getCount()) {
+        return false;
+    }
+
+    const TileEntry& entry = getEntries(data)[index];
+    if (entry.width == 0 || entry.height == 0) {
+        return false;
+    }
+
+    tile.pts = entry.pts;
+    tile.size = sf::Vector2u(entry.width, entry.height);
+    tile.pixels = data + entry.offset;
+    return true;
+}
+
+ThumbnailCache::ThumbnailCache(const std::string& directory, uint64_t maxSize) : directory(directory), maxSize(maxSize) {
+}
+
+bool ThumbnailCache::load(const std::string& filename, size_t count, const sf::Vector2u& maxSize, Strip& strip) const {
+    strip.close();
+
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    if (!CacheFiles::getFileStamp(filename, fileSize, modifiedTime)) {
+        return false;
+    }
+
+    std::string path = getCachePath(filename);
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+        ::close(descriptor);
+        return false;
+    }
+
+    size_t length = static_cast<size_t>(info.st_size);
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    const uint8_t* data = static_cast<const uint8_t*>(mapping);
+    const FileHeader* header = getHeader(data);
+
+    // A strip of another version, another file or a modified file is ignored and generated again
+    bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION &&
+                 header->pathHash == CacheFiles::getPathHash(filename) && header->fileSize == fileSize && header->modifiedTime == modifiedTime &&
+                 header->count == count && header->readyCount == count && header->maxWidth == maxSize.x && header->maxHeight == maxSize.y &&
+                 length >= sizeof(FileHeader) + count * sizeof(TileEntry);
+
+    // Every tile has to lie inside the file before anything is read from it
+    for (size_t i = 0; valid && i < count; ++i) {
+        const TileEntry& entry = getEntries(data)[i];
+        uint64_t tileSize = static_cast<uint64_t>(entry.width) * entry.height * 4;
+        valid = entry.width <= maxSize.x && entry.height <= maxSize.y && entry.offset <= length && tileSize <= length - entry.offset;
+    }
+
+    if (!valid) {
+        munmap(mapping, length);
+        return false;
+    }
+
+    strip.data = data;
+    strip.length = length;
+
+    // Loading counts as a use for eviction
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    return true;
+}
+
+bool ThumbnailCache::save(const std::string& filename, const sf::Vector2u& maxSize, double duration, const std::vector<Tile>& tiles) {
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    if (!CacheFiles::getFileStamp(filename, fileSize, modifiedTime)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.pathHash = CacheFiles::getPathHash(filename);
+    header.fileSize = fileSize;
+    header.modifiedTime = modifiedTime;
+    header.duration = duration;
+    header.count = static_cast<uint32_t>(tiles.size());
+    header.maxWidth = maxSize.x;
+    header.maxHeight = maxSize.y;
+
+    // Tiles follow the table in order, without padding between them
+    std::vector<TileEntry> entries(tiles.size());
+    uint64_t offset = sizeof(FileHeader) + tiles.size() * sizeof(TileEntry);
+
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        bool present = tiles[i].pixels && tiles[i].size.x > 0 && tiles[i].size.y > 0;
+
+        entries[i].pts = tiles[i].pts;
+        entries[i].offset = offset;
+        entries[i].width = present ? tiles[i].size.x : 0;
+        entries[i].height = present ? tiles[i].size.y : 0;
+
+        offset += static_cast<uint64_t>(entries[i].width) * entries[i].height * 4;
+        header.readyCount += present ? 1 : 0;
+    }
+
+    // Write to a temporary file and rename it so readers never map a partial strip. The name is unique, another
+    // process may be saving the same strip.
+    std::string path = getCachePath(filename);
+    std::string temporaryPath = path + ".XXXXXX";
+
+    int descriptor = mkstemp(&temporaryPath[0]);
+    if (descriptor < 0) {
+        return false;
+    }
+    ::close(descriptor);
+
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(TileEntry));
+
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            file.write(reinterpret_cast<const char*>(tiles[i].pixels), static_cast<std::streamsize>(entries[i].width) * entries[i].height * 4);
+        }
+
+        if (!file.flush()) {
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    evictLocked();
+    return true;
+}
+
+void ThumbnailCache::setMaxSize(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    maxSize = bytes;
+    evictLocked();
+}
+
+uint64_t ThumbnailCache::getMaxSize() const {
+    return maxSize;
+}
+
+void ThumbnailCache::evict() {
+    std::lock_guard<std::mutex> lock(mutex);
+    evictLocked();
+}
+
+void ThumbnailCache::evictLocked() {
+    if (maxSize == 0) {
+        return;
+    }
+
+    struct CacheFile {
+        std::filesystem::path path;
+        uint64_t size;
+        std::filesystem::file_time_type lastUse;
+    };
+
+    std::vector<CacheFile> files;
+    uint64_t total = 0;
+
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != EXTENSION) {
+            continue;
+        }
+
+        std::error_code fileError;
+        uint64_t size = it->file_size(fileError);
+        std::filesystem::file_time_type lastUse = it->last_write_time(fileError);
+        if (fileError) {
+            continue;
+        }
+
+        files.push_back({it->path(), size, lastUse});
+        total += size;
+    }
+
+    if (total <= maxSize) {
+        return;
+    }
+
+    // The modification time of a cache file is its last use, load() refreshes it
+    std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.lastUse < b.lastUse; });
+
+    // A strip that is mapped stays readable after its file is removed
+    for (const CacheFile& file : files) {
+        if (total <= maxSize) {
+            break;
+        }
+
+        if (std::filesystem::remove(file.path, error)) {
+            total -= file.size;
+        }
+    }
+}
+
+const std::string& ThumbnailCache::getDirectory() const {
+    return directory;
+}
+
+std::string ThumbnailCache::getCachePath(const std::string& filename) const {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(CacheFiles::getPathHash(filename)));
+    return (std::filesystem::path(directory) / (std::string(name) + EXTENSION)).string();
+}
+
+std::string ThumbnailCache::getDefaultDirectory() {
+    return CacheFiles::getDirectory("thumbnails");
+}
@@ -0,0 +1,392 @@
+#include "../include/ThumbnailGenerator.hpp"
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+ThumbnailGenerator::ThumbnailGenerator()
+    : maxSize(0, 0), workerCount(0), cache(nullptr), nextJob(0), readyCount(0), duration(0.0), activeWorkers(0), aborted(false) {
+}
+
+ThumbnailGenerator::~ThumbnailGenerator() {
+    stop();
+}
+
+bool ThumbnailGenerator::start(const std::string& filename, size_t count, const sf::Vector2u& maxSize) {
+    stop();
+
+    if (count == 0 || maxSize.x == 0 || maxSize.y == 0) {
+        return false;
+    }
+
+    this->filename = filename;
+    this->maxSize = maxSize;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        slots.assign(count, Slot());
+    }
+
+    nextJob = 0;
+    readyCount = 0;
+    duration = 0.0;
+    aborted = false;
+
+    // A cached strip needs no workers at all
+    if (cache && cache->load(filename, count, maxSize, cachedStrip)) {
+        duration = cachedStrip.getDuration();
+        readyCount = cachedStrip.getReadyCount();
+        return true;
+    }
+
+    order = progressiveOrder(count);
+
+    // A few workers are enough, playback keeps the remaining cores
+    unsigned int threads = workerCount;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency() / 4);
+    }
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, count));
+
+    activeWorkers = threads;
+    for (unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThumbnailGenerator::workerLoop, this);
+    }
+
+    return true;
+}
+
+void ThumbnailGenerator::stop() {
+    aborted = true;
+
+    for (std::thread& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    slots.clear();
+    cachedStrip.close();
+    readyCount = 0;
+}
+
+void ThumbnailGenerator::setCache(ThumbnailCache* cache) {
+    this->cache = cache;
+}
+
+ThumbnailCache* ThumbnailGenerator::getCache() const {
+    return cache;
+}
+
+void ThumbnailGenerator::setWorkerCount(unsigned int count) {
+    workerCount = count;
+}
+
+unsigned int ThumbnailGenerator::getWorkerCount() const {
+    return workerCount;
+}
+
+size_t ThumbnailGenerator::getCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return slots.size();
+}
+
+size_t ThumbnailGenerator::getReadyCount() const {
+    return readyCount;
+}
+
+bool ThumbnailGenerator::isComplete() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !slots.empty() && activeWorkers == 0;
+}
+
+bool ThumbnailGenerator::isCached() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cachedStrip.isOpen();
+}
+
+size_t ThumbnailGenerator::getIndex(double seconds) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    double length = duration;
+    if (slots.empty() || length <= 0.0) {
+        return 0;
+    }
+
+    double position = std::max(0.0, seconds) / length * slots.size();
+    return std::min(static_cast<size_t>(position), slots.size() - 1);
+}
+
+bool ThumbnailGenerator::getThumbnail(size_t index, Thumbnail& thumbnail) const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Cached tiles are copied straight out of the mapping
+    if (cachedStrip.isOpen()) {
+        ThumbnailCache::Tile tile;
+        if (!cachedStrip.getTile(index, tile)) {
+            return false;
+        }
+
+        thumbnail.pts = tile.pts;
+        thumbnail.size = tile.size;
+        thumbnail.pixels.assign(tile.pixels, tile.pixels + static_cast<size_t>(tile.size.x) * tile.size.y * 4);
+        return true;
+    }
+
+    if (index >= slots.size() || !slots[index].ready) {
+        return false;
+    }
+
+    thumbnail = slots[index].thumbnail;
+    return true;
+}
+
+void ThumbnailGenerator::workerLoop() {
+#ifdef __linux__
+    // Linux applies niceness per thread, playback decoding always gets the CPU first
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), WORKER_NICENESS);
+#endif
+
+    WorkerContext worker;
+    bool opened = openWorker(worker);
+    size_t count = order.size();
+
+    while (opened && !aborted) {
+        size_t job = nextJob.fetch_add(1);
+        if (job >= count) {
+            break;
+        }
+
+        // Sample the middle of each section of the strip
+        size_t index = order[job];
+        double seconds = (index + 0.5) * duration / count;
+
+        Thumbnail thumbnail;
+        if (!decodeThumbnail(worker, seconds, thumbnail)) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (aborted) {
+            break;
+        }
+
+        slots[index].thumbnail = std::move(thumbnail);
+        slots[index].ready = true;
+        ++readyCount;
+    }
+
+    closeWorker(worker);
+
+    if (--activeWorkers == 0 && !aborted) {
+        saveToCache();
+    }
+}
+
+void ThumbnailGenerator::saveToCache() {
+    // A position can fail for a passing reason, only complete strips are stored so it is tried again next time
+    if (!cache || readyCount < slots.size()) {
+        return;
+    }
+
+    // No worker is left to change the slots and stop() waits for this thread, so they are read unlocked
+    std::vector<ThumbnailCache::Tile> tiles(slots.size());
+    for (size_t i = 0; i < slots.size(); ++i) {
+        const Slot& slot = slots[i];
+        tiles[i].pts = slot.ready ? slot.thumbnail.pts : 0.0;
+        tiles[i].size = slot.ready ? slot.thumbnail.size : sf::Vector2u(0, 0);
+        tiles[i].pixels = slot.ready ? slot.thumbnail.pixels.data() : nullptr;
+    }
+
+    cache->save(filename, maxSize, duration, tiles);
+}
+
+bool ThumbnailGenerator::openWorker(WorkerContext& worker) {
+    if (avformat_open_input(&worker.formatContext, filename.c_str(), nullptr, nullptr) < 0) {
+        return false;
+    }
+
+    if (avformat_find_stream_info(worker.formatContext, nullptr) < 0) {
+        return false;
+    }
+
+    worker.streamIndex = av_find_best_stream(worker.formatContext, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (worker.streamIndex < 0) {
+        return false;
+    }
+
+    // Only the video stream is read
+    for (unsigned int i = 0; i < worker.formatContext->nb_streams; ++i) {
+        if (static_cast<int>(i) != worker.streamIndex) {
+            worker.formatContext->streams[i]->discard = AVDISCARD_ALL;
+        }
+    }
+
+    AVStream* stream = worker.formatContext->streams[worker.streamIndex];
+
+    if (worker.formatContext->duration > 0) {
+        duration = worker.formatContext->duration / static_cast<double>(AV_TIME_BASE);
+    } else if (stream->duration != AV_NOPTS_VALUE) {
+        duration = stream->duration * av_q2d(stream->time_base);
+    }
+
+    const AVCodec* codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        return false;
+    }
+
+    worker.codecContext = avcodec_alloc_context3(codec);
+    if (!worker.codecContext || avcodec_parameters_to_context(worker.codecContext, stream->codecpar) < 0) {
+        return false;
+    }
+
+    // One thread per worker, and everything but keyframes is discarded by the decoder
+    worker.codecContext->thread_count = 1;
+    worker.codecContext->skip_frame = AVDISCARD_NONKEY;
+
+    // Decode at reduced resolution where the codec supports it, as long as it stays above the thumbnail size
+    int lowres = 0;
+    while (lowres < codec->max_lowres && (stream->codecpar->width >> (lowres + 1)) >= static_cast<int>(maxSize.x) &&
+           (stream->codecpar->height >> (lowres + 1)) >= static_cast<int>(maxSize.y)) {
+        ++lowres;
+    }
+    worker.codecContext->lowres = lowres;
+
+    if (avcodec_open2(worker.codecContext, codec, nullptr) < 0) {
+        return false;
+    }
+
+    worker.packet = av_packet_alloc();
+    worker.frame = av_frame_alloc();
+    return worker.packet && worker.frame;
+}
+
+void ThumbnailGenerator::closeWorker(WorkerContext& worker) {
+    if (worker.swsContext) {
+        sws_freeContext(worker.swsContext);
+        worker.swsContext = nullptr;
+    }
+
+    av_frame_free(&worker.frame);
+    av_packet_free(&worker.packet);
+    avcodec_free_context(&worker.codecContext);
+
+    if (worker.formatContext) {
+        avformat_close_input(&worker.formatContext);
+    }
+}
+
+bool ThumbnailGenerator::decodeThumbnail(WorkerContext& worker, double seconds, Thumbnail& thumbnail) {
+    AVStream* stream = worker.formatContext->streams[worker.streamIndex];
+
+    int64_t timestamp = static_cast<int64_t>(seconds / av_q2d(stream->time_base));
+    if (stream->start_time != AV_NOPTS_VALUE) {
+        timestamp += stream->start_time;
+    }
+
+    if (av_seek_frame(worker.formatContext, worker.streamIndex, timestamp, AVSEEK_FLAG_BACKWARD) < 0) {
+        return false;
+    }
+
+    avcodec_flush_buffers(worker.codecContext);
+
+    bool decoded = false;
+    for (int packets = 0; packets < MAX_PACKETS_PER_THUMBNAIL && !aborted && !decoded; ++packets) {
+        if (av_read_frame(worker.formatContext, worker.packet) < 0) {
+            break;
+        }
+
+        // Packets between keyframes are skipped without being sent to the decoder
+        if (worker.packet->stream_index != worker.streamIndex || !(worker.packet->flags & AV_PKT_FLAG_KEY)) {
+            av_packet_unref(worker.packet);
+            continue;
+        }
+
+        int sendResult = avcodec_send_packet(worker.codecContext, worker.packet);
+        av_packet_unref(worker.packet);
+
+        if (sendResult < 0) {
+            continue;
+        }
+
+        // Drain so the keyframe comes out now, a drained decoder only accepts packets again after a flush
+        avcodec_send_packet(worker.codecContext, nullptr);
+        decoded = avcodec_receive_frame(worker.codecContext, worker.frame) == 0;
+        avcodec_flush_buffers(worker.codecContext);
+    }
+
+    if (!decoded) {
+        return false;
+    }
+
+    // Scale straight from the decoded frame to the thumbnail size, area averaging keeps small images sharp
+    AVFrame* frame = worker.frame;
+    sf::Vector2u size = getScaledSize(frame->width, frame->height);
+
+    worker.swsContext = sws_getCachedContext(worker.swsContext, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format), size.x,
+                                             size.y, AV_PIX_FMT_RGBA, SWS_AREA, nullptr, nullptr, nullptr);
+    if (!worker.swsContext) {
+        av_frame_unref(frame);
+        return false;
+    }
+
+    thumbnail.size = size;
+    thumbnail.pixels.resize(static_cast<size_t>(size.x) * size.y * 4);
+
+    uint8_t* dstData[4] = {thumbnail.pixels.data(), nullptr, nullptr, nullptr};
+    int dstLinesize[4] = {static_cast<int>(size.x) * 4, 0, 0, 0};
+    sws_scale(worker.swsContext, frame->data, frame->linesize, 0, frame->height, dstData, dstLinesize);
+
+    int64_t pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : frame->pts;
+    thumbnail.pts = pts != AV_NOPTS_VALUE ? pts * av_q2d(stream->time_base) : seconds;
+
+    av_frame_unref(frame);
+    return true;
+}
+
+sf::Vector2u ThumbnailGenerator::getScaledSize(int width, int height) const {
+    sf::Vector2u size(std::max(1, width), std::max(1, height));
+
+    // Fit inside the thumbnail size, only ever scaling down
+    double scale = std::min(static_cast<double>(maxSize.x) / size.x, static_cast<double>(maxSize.y) / size.y);
+    if (scale >= 1.0) {
+        return size;
+    }
+
+    size.x = std::max(1u, static_cast<unsigned int>(size.x * scale + 0.5));
+    size.y = std::max(1u, static_cast<unsigned int>(size.y * scale + 0.5));
+    return size;
+}
+
+std::vector<size_t> ThumbnailGenerator::progressiveOrder(size_t count) {
+    size_t bits = 0;
+    while ((size_t(1) << bits) < count) {
+        ++bits;
+    }
+
+    // Bit-reversed counting visits the strip coarse to fine
+    std::vector<size_t> result;
+    result.reserve(count);
+
+    for (size_t i = 0; i < (size_t(1) << bits); ++i) {
+        size_t reversed = 0;
+        for (size_t bit = 0; bit < bits; ++bit) {
+            if (i & (size_t(1) << bit)) {
+                reversed |= size_t(1) << (bits - 1 - bit);
+            }
+        }
+
+        if (reversed < count) {
+            result.push_back(reversed);
+        }
+    }
+
+    return result;
+}
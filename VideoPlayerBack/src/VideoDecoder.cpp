@@ -1,14 +1,34 @@
 #include "../include/VideoDecoder.hpp"
 
+#include <algorithm>
 #include <iostream>
 
 VideoDecoder::VideoDecoder()
-    : MediaDecoder(), codecContext(nullptr), swsContext(nullptr), videoStream(nullptr), videoStreamIndex(-1), running(false), paused(false) {
+    : MediaDecoder(),
+      codecContext(nullptr),
+      swsContext(nullptr),
+      videoStream(nullptr),
+      videoStreamIndex(-1),
+      inputQueue(nullptr),
+      outputSize(0, 0),
+      scalingQuality(BILINEAR),
+      frameQueue(MAX_QUEUE_SIZE),
+      running(false),
+      paused(false),
+      keyframesOnly(false),
+      codecPacket(nullptr),
+      codecFrame(nullptr),
+      inputEnded(false),
+      drainPending(false),
+      frameDuration(0.0) {
 }
 
 VideoDecoder::~VideoDecoder() {
     stop();
 
+    av_packet_free(&codecPacket);
+    av_frame_free(&codecFrame);
+
     if (swsContext) {
         sws_freeContext(swsContext);
         swsContext = nullptr;
@@ -23,52 +43,85 @@ VideoDecoder::~VideoDecoder() {
 bool VideoDecoder::initialize() {
     std::lock_guard<std::mutex> lock(mutex);
 
-    if (!opened || !formatContext) {
+    if (!opened || !demuxer) {
         return false;
     }
 
     // Find video stream
     videoStreamIndex = findStream(AVMEDIA_TYPE_VIDEO);
     if (videoStreamIndex < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::STREAM_ERROR, "No video stream found in the file");
+        errors.report(MediaPlayerException::STREAM_ERROR, "No video stream found in the file");
         return false;
     }
 
-    videoStream = formatContext->streams[videoStreamIndex];
+    videoStream = demuxer->getStream(videoStreamIndex);
+
+    // Subscribe to the packets of the video stream
+    inputQueue = demuxer->openStream(videoStreamIndex);
+    if (!inputQueue) {
+        errors.report(MediaPlayerException::STREAM_ERROR, "Failed to open video packet queue");
+        return false;
+    }
 
     // Find decoder for the stream
     const AVCodec* codec = avcodec_find_decoder(videoStream->codecpar->codec_id);
     if (!codec) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::CODEC_ERROR, "Unsupported video codec");
+        errors.report(MediaPlayerException::CODEC_ERROR, "Unsupported video codec");
         return false;
     }
 
     // Allocate codec context
     codecContext = avcodec_alloc_context3(codec);
     if (!codecContext) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to allocate video codec context");
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate video codec context");
         return false;
     }
 
     // Copy codec parameters to context
     if (avcodec_parameters_to_context(codecContext, videoStream->codecpar) < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to copy video codec parameters to context");
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to copy video codec parameters to context");
         return false;
     }
 
+    // Decode on multiple threads where the codec supports it
+    applyThreading(codecContext, codec);
+
     // Open codec
     if (avcodec_open2(codecContext, codec, nullptr) < 0) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to open video codec");
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to open video codec");
         return false;
     }
 
+    // Size conversion buffers from the stream dimensions
+    sf::Vector2u scaledSize = getScaledSize(codecContext->width, codecContext->height);
+    bufferPool.setBufferSize(static_cast<size_t>(scaledSize.x) * scaledSize.y * 4);
+    bufferPool.preallocate(2);
+
+    sendLatency.reset();
+    receiveLatency.reset();
+    queueWaitLatency.reset();
+    convertLatency.reset();
+    uploadLatency.reset();
+
     return true;
 }
 
 void VideoDecoder::start() {
     std::lock_guard<std::mutex> lock(mutex);
 
-    if (running) {
+    if (running || !opened) {
+        return;
+    }
+
+    if (!codecPacket) {
+        codecPacket = av_packet_alloc();
+    }
+    if (!codecFrame) {
+        codecFrame = av_frame_alloc();
+    }
+
+    if (!codecPacket || !codecFrame) {
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate video packet or frame");
         return;
     }
 
@@ -76,12 +129,22 @@ void VideoDecoder::start() {
     paused = false;
 
     // Clear any existing frames
-    while (!frameQueue.empty()) {
-        frameQueue.pop();
-    }
+    frameQueue.clear();
+
+    // A frame is shown until the next one, so the frame on screen at a seek target ends after it
+    double frameRate = getFrameRate();
+    frameDuration = frameRate > 0.0 ? 1.0 / frameRate : 0.0;
+
+    epochState = EpochState();
+    inputEnded = false;
+    drainPending = false;
+
+    // Decode whenever packets arrive, steps run on the shared executor
+    inputQueue->setPushCallback([this] { requestDecode(); });
+    startSteps();
 
-    // Start decoding thread
-    decodingThread = std::thread(&VideoDecoder::decodingLoop, this);
+    // Make sure packets are flowing
+    demuxer->start();
 }
 
 void VideoDecoder::stop() {
@@ -96,34 +159,37 @@ void VideoDecoder::stop() {
         paused = false;
     }
 
-    // Notify condition variable to wake up thread
-    queueCondition.notify_all();
-
-    // Wait for thread to finish
-    if (decodingThread.joinable()) {
-        decodingThread.join();
-    }
+    // No step is queued or running once this returns
+    inputQueue->setPushCallback(nullptr);
+    stopSteps();
 
     // Clear queue
-    std::lock_guard<std::mutex> lock(queueMutex);
-    while (!frameQueue.empty()) {
-        frameQueue.pop();
-    }
+    frameQueue.clear();
+    pendingFrame.frame.reset();
 }
 
 bool VideoDecoder::getNextFrame(VideoFrame& frame) {
-    std::lock_guard<std::mutex> lock(queueMutex);
+    discardStaleFrames();
 
-    if (frameQueue.empty()) {
+    // Lock-free, a decoder waiting for space runs again
+    if (!frameQueue.tryPop(frame)) {
         return false;
     }
 
-    frame = frameQueue.front();
-    frameQueue.pop();
+    queueWaitLatency.record(frame.queuedTime);
+    requestDecode();
+    return true;
+}
 
-    // Notify decoding thread that a frame was consumed
-    queueCondition.notify_one();
+bool VideoDecoder::peekNextFramePts(double& pts) {
+    discardStaleFrames();
 
+    const VideoFrame* next = frameQueue.front();
+    if (!next) {
+        return false;
+    }
+
+    pts = next->pts;
     return true;
 }
 
@@ -147,6 +213,45 @@ double VideoDecoder::getFrameRate() const {
     return static_cast<double>(videoStream->avg_frame_rate.num) / static_cast<double>(videoStream->avg_frame_rate.den);
 }
 
+int VideoDecoder::getThreadCount() const {
+    return activeThreadCount(codecContext);
+}
+
+void VideoDecoder::setHugePageBuffers(bool enabled) {
+    bufferPool.setHugePages(enabled);
+}
+
+void VideoDecoder::setOutputSize(const sf::Vector2u& size) {
+    outputSize = size;
+}
+
+sf::Vector2u VideoDecoder::getOutputSize() const {
+    return outputSize;
+}
+
+void VideoDecoder::setScalingQuality(ScalingQuality quality) {
+    scalingQuality = quality;
+}
+
+VideoDecoder::ScalingQuality VideoDecoder::getScalingQuality() const {
+    return scalingQuality;
+}
+
+FrameBufferPool::Stats VideoDecoder::getBufferPoolStats() const {
+    return bufferPool.getStats();
+}
+
+MediaDecoder::QueueStats VideoDecoder::getQueueStats() const {
+    QueueStats stats{frameQueue.size(), 0, 0};
+
+    if (opened && inputQueue) {
+        stats.packets = inputQueue->size();
+        stats.packetBytes = inputQueue->byteSize();
+    }
+
+    return stats;
+}
+
 bool VideoDecoder::hasMoreFrames() const {
     return running && opened;
 }
@@ -155,8 +260,8 @@ void VideoDecoder::setPaused(bool paused) {
     this->paused = paused;
 
     if (!paused) {
-        // Notify thread to continue if it was waiting
-        queueCondition.notify_one();
+        // Continue where the last step stopped
+        requestDecode();
     }
 }
 
@@ -164,166 +269,304 @@ bool VideoDecoder::isPaused() const {
     return paused;
 }
 
-void VideoDecoder::decodingLoop() {
-    AVPacket* packet = av_packet_alloc();
-    AVFrame* frame = av_frame_alloc();
+void VideoDecoder::setKeyframesOnly(bool enabled) {
+    keyframesOnly = enabled;
+}
 
-    if (!packet || !frame) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to allocate video packet or frame");
+bool VideoDecoder::decodeStep() {
+    for (int i = 0; i < STEP_PACKETS; ++i) {
+        if (paused) {
+            return false;
+        }
 
-        if (packet)
-            av_packet_free(&packet);
-        if (frame)
-            av_frame_free(&frame);
+        // Frames the codec holds go out before it is fed more
+        if (!receiveFrames()) {
+            return false;
+        }
 
-        return;
-    }
+        uint64_t packetEpoch;
+        if (!inputQueue->pop(codecPacket, packetEpoch, std::chrono::milliseconds(0))) {
+            return false;
+        }
 
-    while (running) {
-        // Check if paused
-        if (paused) {
-            std::unique_lock<std::mutex> lock(mutex);
-            queueCondition.wait(lock, [this] { return !paused || !running; });
+        // Packets read before the latest seek are dropped without decoding
+        uint64_t previousEpoch = epochState.epoch;
+        if (!enterEpoch(epochState, packetEpoch, codecContext)) {
+            av_packet_unref(codecPacket);
+            continue;
+        }
 
-            if (!running) {
-                break;
-            }
+        // A new epoch has flushed the codec
+        if (epochState.epoch != previousEpoch) {
+            inputEnded = false;
+        }
 
+        // The empty packet at the end of the file drains the codec
+        bool endOfInput = isEndOfStreamPacket(codecPacket);
+        inputEnded = inputEnded || endOfInput;
+
+        // In keyframe-only mode everything between keyframes is skipped without decoding
+        bool drainKeyframe = keyframesOnly;
+        if (drainKeyframe && !endOfInput && !(codecPacket->flags & AV_PKT_FLAG_KEY)) {
+            av_packet_unref(codecPacket);
             continue;
         }
 
-        // Check if queue is full
-        {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            if (frameQueue.size() >= MAX_QUEUE_SIZE) {
-                queueCondition.wait(lock, [this] { return frameQueue.size() < MAX_QUEUE_SIZE || !running; });
+        // Send packet to decoder
+        auto sendStart = LatencyHistogram::now();
+        int sendResult = avcodec_send_packet(codecContext, codecPacket);
+        sendLatency.record(sendStart);
+        av_packet_unref(codecPacket);
 
-                if (!running) {
-                    break;
-                }
+        if (sendResult < 0) {
+            errors.report(MediaPlayerException::DECODER_ERROR,
+                          "Error sending packet to video decoder: " + ErrorHandler::ffmpegErrorToString(sendResult));
+            continue;
+        }
 
-                continue;
-            }
+        // Drain so a frame-threaded codec outputs the keyframe now instead of after the next few packets
+        if (drainKeyframe) {
+            avcodec_send_packet(codecContext, nullptr);
+            drainPending = true;
         }
+    }
 
-        // Read packet
-        int readResult;
-        {
-            std::lock_guard<std::mutex> lock(mutex);
+    // Frames of the last packet are received by the next step
+    return true;
+}
 
-            if (!formatContext) {
-                break;
-            }
+double VideoDecoder::getQueuedSeconds() const {
+    return frameQueue.size() * frameDuration;
+}
 
-            readResult = av_read_frame(formatContext, packet);
+bool VideoDecoder::receiveFrames() {
+    // A frame the full queue refused goes first, unless a seek has superseded it
+    if (pendingFrame.frame) {
+        if (!isStaleEpoch(pendingFrame.epoch) && !frameQueue.tryPush(std::move(pendingFrame))) {
+            return false;
         }
 
-        if (readResult < 0) {
-            // End of file or error
-            if (readResult == AVERROR_EOF) {
-                // End of file, loop back to beginning
-                seek(0);
-                continue;
-            } else {
-                // Error
-                ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR,
-                                                        "Error reading video frame: " + ErrorHandler::ffmpegErrorToString(readResult));
-                break;
+        pendingFrame.frame.reset();
+    }
+
+    while (true) {
+        auto receiveStart = LatencyHistogram::now();
+        int receiveResult = avcodec_receive_frame(codecContext, codecFrame);
+
+        if (receiveResult == AVERROR(EAGAIN) || receiveResult == AVERROR_EOF) {
+            // Need more packets or end of stream, after the end of the file every frame is queued now
+            if (receiveResult == AVERROR_EOF && inputEnded) {
+                setEndOfStream(epochState);
             }
+            break;
+        } else if (receiveResult < 0) {
+            // Error
+            errors.report(MediaPlayerException::DECODER_ERROR, "Error receiving frame from video decoder: " +
+                                                                   ErrorHandler::ffmpegErrorToString(receiveResult));
+            break;
         }
 
-        // Check if this packet belongs to the video stream
-        if (packet->stream_index != videoStreamIndex) {
-            av_packet_unref(packet);
+        receiveLatency.record(receiveStart);
+
+        // Calculate presentation timestamp in seconds
+        double pts = 0.0;
+        if (codecFrame->pts != AV_NOPTS_VALUE) {
+            pts = codecFrame->pts * av_q2d(videoStream->time_base);
+        }
+
+        // Frames superseded by a seek or decoded on the way to an exact seek target are never queued or converted
+        if (isStaleEpoch(epochState.epoch) || skipBeforeSeekTarget(epochState, pts + frameDuration)) {
+            av_frame_unref(codecFrame);
             continue;
         }
 
-        // Send packet to decoder
-        int sendResult = avcodec_send_packet(codecContext, packet);
-        av_packet_unref(packet);
+        // Queue a reference to the decoded frame, conversion happens when it is presented
+        VideoFrame videoFrame;
+        videoFrame.pts = pts;
+        videoFrame.epoch = epochState.epoch;
+        videoFrame.frame.reset(av_frame_alloc());
 
-        if (sendResult < 0) {
-            ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR,
-                                                    "Error sending packet to video decoder: " + ErrorHandler::ffmpegErrorToString(sendResult));
+        if (!videoFrame.frame) {
+            errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate video frame reference");
+            av_frame_unref(codecFrame);
             break;
         }
 
-        // Receive frames from decoder
-        while (running) {
-            int receiveResult = avcodec_receive_frame(codecContext, frame);
-
-            if (receiveResult == AVERROR(EAGAIN) || receiveResult == AVERROR_EOF) {
-                // Need more packets or end of stream
-                break;
-            } else if (receiveResult < 0) {
-                // Error
-                ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Error receiving frame from video decoder: " +
-                                                                                                 ErrorHandler::ffmpegErrorToString(receiveResult));
-                break;
-            }
-
-            // Convert frame to texture and add to queue
-            VideoFrame videoFrame;
+        av_frame_move_ref(videoFrame.frame.get(), codecFrame);
+        videoFrame.queuedTime = LatencyHistogram::now();
+        decodedCount.fetch_add(1, std::memory_order_relaxed);
 
-            // Calculate presentation timestamp in seconds
-            double pts = 0.0;
-            if (frame->pts != AV_NOPTS_VALUE) {
-                pts = frame->pts * av_q2d(videoStream->time_base);
-            }
+        // Hand the frame to the consumer, a full queue keeps it for the next step
+        if (!frameQueue.tryPush(std::move(videoFrame))) {
+            pendingFrame = std::move(videoFrame);
+            return false;
+        }
+    }
 
-            videoFrame.pts = pts;
+    // A drained codec only accepts packets again after a flush
+    if (drainPending) {
+        avcodec_flush_buffers(codecContext);
+        drainPending = false;
+    }
 
-            if (convertFrameToTexture(frame, videoFrame.texture)) {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                frameQueue.push(videoFrame);
-            }
+    return true;
+}
 
-            av_frame_unref(frame);
+void VideoDecoder::discardStaleFrames() {
+    // Frames decoded before the latest seek may still be queued, they are released unconverted
+    while (VideoFrame* queued = frameQueue.front()) {
+        if (!isStaleEpoch(queued->epoch)) {
+            break;
         }
-    }
 
-    av_packet_free(&packet);
-    av_frame_free(&frame);
+        frameQueue.popFront();
+        requestDecode();
+    }
 }
 
-bool VideoDecoder::convertFrameToTexture(AVFrame* frame, sf::Texture& texture) {
-    // Create SwsContext if needed
-    if (!swsContext) {
-        swsContext = sws_getContext(codecContext->width, codecContext->height, codecContext->pix_fmt, codecContext->width, codecContext->height,
-                                    AV_PIX_FMT_RGBA, SWS_BILINEAR, nullptr, nullptr, nullptr);
+FrameBufferPool::Buffer VideoDecoder::convertFrame(const AVFrame* frame, sf::Vector2u& size) {
+    if (!frame) {
+        return FrameBufferPool::Buffer();
+    }
+
+    auto convertStart = LatencyHistogram::now();
+
+    // Convert straight to the size the frame is displayed at
+    size = getScaledSize(frame->width, frame->height);
+    bool scaled = size.x != static_cast<unsigned int>(frame->width) || size.y != static_cast<unsigned int>(frame->height);
+
+    // Get buffer for RGBA data from the pool, it goes back when the caller releases it
+    bufferPool.setBufferSize(static_cast<size_t>(size.x) * size.y * 4);
+    FrameBufferPool::Buffer buffer = bufferPool.acquire();
+    if (!buffer) {
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to allocate video buffer");
+        return buffer;
+    }
+
+    if (!scaled && configureColorConverter(frame)) {
+        // Convert frame to RGBA with the SIMD converter
+        colorConverter.convert(frame->data, frame->linesize, frame->width, frame->height, buffer.data(), frame->width * 4);
+    } else {
+        int flags = SWS_BILINEAR;
+        if (scaled && scalingQuality == FAST) {
+            flags = SWS_FAST_BILINEAR;
+        } else if (scaled && scalingQuality == BICUBIC) {
+            flags = SWS_BICUBIC;
+        }
+
+        // Create SwsContext if needed, or recreate it if the frame format or output size changed
+        swsContext = sws_getCachedContext(swsContext, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format), size.x, size.y,
+                                          AV_PIX_FMT_RGBA, flags, nullptr, nullptr, nullptr);
 
         if (!swsContext) {
-            ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to create video scaling context");
-            return false;
+            errors.report(MediaPlayerException::DECODER_ERROR, "Failed to create video scaling context");
+            return FrameBufferPool::Buffer();
         }
+
+        // Set up pointers for conversion
+        uint8_t* dst_data[4] = {buffer.data(), nullptr, nullptr, nullptr};
+        int dst_linesize[4] = {static_cast<int>(size.x) * 4, 0, 0, 0};
+
+        // Convert frame to RGBA
+        sws_scale(swsContext, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
     }
 
-    // Allocate buffer for RGBA data
-    uint8_t* buffer = new uint8_t[codecContext->width * codecContext->height * 4];
+    convertLatency.record(convertStart);
+    return buffer;
+}
+
+bool VideoDecoder::convertFrameToTexture(const AVFrame* frame, sf::Texture& texture) {
+    // The buffer is recycled once the texture is updated
+    sf::Vector2u size;
+    FrameBufferPool::Buffer buffer = convertFrame(frame, size);
     if (!buffer) {
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to allocate video buffer");
         return false;
     }
 
-    // Set up pointers for conversion
-    uint8_t* dst_data[4] = {buffer, nullptr, nullptr, nullptr};
-    int dst_linesize[4] = {codecContext->width * 4, 0, 0, 0};
-
-    // Convert frame to RGBA
-    sws_scale(swsContext, frame->data, frame->linesize, 0, codecContext->height, dst_data, dst_linesize);
+    auto uploadStart = LatencyHistogram::now();
 
-    // Create SFML texture
-    if (!texture.create(codecContext->width, codecContext->height)) {
-        delete[] buffer;
-        ErrorHandler::getInstance().handleError(MediaPlayerException::DECODER_ERROR, "Failed to create video texture");
+    // Create SFML texture, reuse the existing one when the size did not change
+    if (texture.getSize() != size && !texture.create(size.x, size.y)) {
+        errors.report(MediaPlayerException::DECODER_ERROR, "Failed to create video texture");
         return false;
     }
 
     // Update texture with pixel data
-    texture.update(buffer);
+    texture.update(buffer.data());
+    uploadLatency.record(uploadStart);
+
+    return true;
+}
+
+VideoDecoder::StageLatencies VideoDecoder::getStageLatencies() const {
+    StageLatencies latencies;
+    latencies.send = sendLatency.getSummary();
+    latencies.receive = receiveLatency.getSummary();
+    latencies.queueWait = queueWaitLatency.getSummary();
+    latencies.convert = convertLatency.getSummary();
+    latencies.upload = uploadLatency.getSummary();
+    return latencies;
+}
+
+sf::Vector2u VideoDecoder::getScaledSize(int width, int height) const {
+    sf::Vector2u size(width, height);
+
+    if (outputSize.x == 0 || outputSize.y == 0 || width <= 0 || height <= 0) {
+        return size;
+    }
 
-    // Free buffer
-    delete[] buffer;
+    // Fit inside the output size, only ever scaling down
+    double scale = std::min(static_cast<double>(outputSize.x) / width, static_cast<double>(outputSize.y) / height);
+    if (scale >= 1.0) {
+        return size;
+    }
+
+    size.x = std::max(1u, static_cast<unsigned int>(width * scale + 0.5));
+    size.y = std::max(1u, static_cast<unsigned int>(height * scale + 0.5));
+    return size;
+}
+
+bool VideoDecoder::configureColorConverter(const AVFrame* frame) {
+    ColorConverter::PixelLayout layout;
+    bool fullRange = frame->color_range == AVCOL_RANGE_JPEG;
+
+    switch (frame->format) {
+        case AV_PIX_FMT_YUVJ420P:
+            fullRange = true;
+            // fall through
+        case AV_PIX_FMT_YUV420P:
+            layout = ColorConverter::YUV420P;
+            break;
+        case AV_PIX_FMT_NV12:
+            layout = ColorConverter::NV12;
+            break;
+        case AV_PIX_FMT_YUVJ422P:
+            fullRange = true;
+            // fall through
+        case AV_PIX_FMT_YUV422P:
+            layout = ColorConverter::YUV422P;
+            break;
+        default:
+            return false;
+    }
+
+    // Untagged streams follow the usual convention of BT.709 for HD and BT.601 for SD
+    ColorConverter::Matrix matrix;
+    switch (frame->colorspace) {
+        case AVCOL_SPC_BT709:
+            matrix = ColorConverter::BT709;
+            break;
+        case AVCOL_SPC_BT470BG:
+        case AVCOL_SPC_SMPTE170M:
+            matrix = ColorConverter::BT601;
+            break;
+        case AVCOL_SPC_UNSPECIFIED:
+            matrix = frame->height >= 720 ? ColorConverter::BT709 : ColorConverter::BT601;
+            break;
+        default:
+            return false;
+    }
 
+    colorConverter.configure(layout, matrix, fullRange ? ColorConverter::FULL : ColorConverter::LIMITED);
     return true;
 }
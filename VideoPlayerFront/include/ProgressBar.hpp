@@ -18,12 +18,23 @@ class ProgressBar {
         bool contains(const sf::Vector2f& point) const;
         double getPositionFromClick(float x) const;
 
+        // Hover preview shown above the bar at the mouse position
+        void setHoverState(bool isHovering, float x);
+        void setPreview(const sf::Texture& texture);
+        void clearPreview();
+
     private:
         std::string formatTime(double seconds);
 
         sf::RectangleShape background;
         sf::RectangleShape fill;
         sf::Text timeText;
+        sf::Sprite previewSprite;
+        sf::RectangleShape previewFrame;
+        sf::Text previewTimeText;
+        bool isHovering = false;
+        bool hasPreview = false;
+        float hoverX = 0.0f;
         double currentTime = 0.0;
         double duration = 0.0;
     };
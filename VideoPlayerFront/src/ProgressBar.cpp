@@ -13,6 +13,14 @@ ProgressBar::ProgressBar(const sf::Font& font) {
     timeText.setCharacterSize(12);
     timeText.setFillColor(TEXT_COLOR);
     timeText.setString("00:00 / 00:00");
+
+    previewFrame.setFillColor(sf::Color::Black);
+    previewFrame.setOutlineColor(PROGRESS_BAR_FILL_COLOR);
+    previewFrame.setOutlineThickness(1.0f);
+
+    previewTimeText.setFont(font);
+    previewTimeText.setCharacterSize(12);
+    previewTimeText.setFillColor(TEXT_COLOR);
 }
 
 void ProgressBar::setSize(float width, float height) {
@@ -45,6 +53,39 @@ void ProgressBar::draw(sf::RenderWindow& window) {
     window.draw(background);
     window.draw(fill);
     window.draw(timeText);
+
+    if (!isHovering || duration <= 0) {
+        return;
+    }
+
+    // Time under the mouse, with the thumbnail above it once one is available
+    float bottom = background.getPosition().y - 5.0f;
+    previewTimeText.setString(formatTime(getPositionFromClick(hoverX)));
+    sf::FloatRect textBounds = previewTimeText.getLocalBounds();
+
+    sf::Vector2f previewSize(textBounds.width, 0.0f);
+    if (hasPreview) {
+        sf::Vector2u textureSize = previewSprite.getTexture()->getSize();
+        previewSize = sf::Vector2f(std::max<float>(textureSize.x, textBounds.width), textureSize.y);
+    }
+
+    // Keep the preview over the bar near its ends
+    float left = background.getPosition().x;
+    float right = left + background.getSize().x - previewSize.x;
+    float x = std::max(left, std::min(hoverX - previewSize.x / 2.0f, right));
+    float textY = bottom - textBounds.height - textBounds.top;
+
+    if (hasPreview) {
+        float previewY = textY - 5.0f - previewSize.y;
+        previewFrame.setSize(previewSize);
+        previewFrame.setPosition(x, previewY);
+        previewSprite.setPosition(x + (previewSize.x - previewSprite.getTexture()->getSize().x) / 2.0f, previewY);
+        window.draw(previewFrame);
+        window.draw(previewSprite);
+    }
+
+    previewTimeText.setPosition(x + (previewSize.x - textBounds.width) / 2.0f - textBounds.left, textY);
+    window.draw(previewTimeText);
 }
 
 bool ProgressBar::contains(const sf::Vector2f& point) const {
@@ -57,6 +98,20 @@ double ProgressBar::getPositionFromClick(float x) const {
     return ratio * duration;
 }
 
+void ProgressBar::setHoverState(bool isHovering, float x) {
+    this->isHovering = isHovering;
+    hoverX = x;
+}
+
+void ProgressBar::setPreview(const sf::Texture& texture) {
+    previewSprite.setTexture(texture, true);
+    hasPreview = true;
+}
+
+void ProgressBar::clearPreview() {
+    hasPreview = false;
+}
+
 std::string ProgressBar::formatTime(double seconds) {
     int mins = static_cast<int>(seconds) / 60;
     int secs = static_cast<int>(seconds) % 60;